@@ -0,0 +1,38 @@
+#ifndef BACKOFF_H
+#define BACKOFF_H
+
+#include <immintrin.h>
+#include <stdint.h>
+
+/**
+ * Bounded exponential backoff for CAS retry loops. Every Pause() spins on pause instructions,
+ * a random number between half and all of the current limit so that threads that failed
+ * together do not retry together, and then doubles the limit up to max_spins.
+ */
+class Backoff {
+   private:
+	uint32_t spins;
+	const uint32_t max_spins;
+
+	static uint32_t Random() {
+		static thread_local uint32_t state = 0x9E3779B9u ^ (uint32_t)(uintptr_t)&state;
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+   public:
+	Backoff(uint32_t min_spins, uint32_t max_spins) : spins(min_spins), max_spins(max_spins) {}
+
+	void Pause() {
+		if (spins == 0)
+			return;
+		uint32_t n = spins / 2 + Random() % (spins - spins / 2);
+		for (uint32_t i = 0; i < n; i++)
+			_mm_pause();
+		spins = spins * 2 < max_spins ? spins * 2 : max_spins;
+	}
+};
+
+#endif
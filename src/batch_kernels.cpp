@@ -0,0 +1,221 @@
+/**
+ * @file batch_kernels.cpp
+ * @author Josef Salzmann &	Aleksandar Hadzhiyski
+ * @brief AVX2 and AVX-512 kernels hashing and bit reversing the keys of batch operations.
+ * @date 2026-10-15
+ */
+#include "batch_kernels.h"
+
+#include <immintrin.h>
+
+#include "split_order.h"
+
+static SimdLevel DetectSimdLevel() {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq"))
+		return SimdLevel::AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return SimdLevel::AVX2;
+	return SimdLevel::SCALAR;
+}
+
+static const SimdLevel supported_simd_level = DetectSimdLevel();
+static SimdLevel simd_level = supported_simd_level;
+
+/**
+ * Bit reversal of every nibble, shifted into the upper nibble and as it is, for reversing
+ * the bits of every byte with two byte shuffles.
+ */
+alignas(16) static const uint8_t REVERSED_LOW_NIBBLES[16] = {0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0};
+alignas(16) static const uint8_t REVERSED_HIGH_NIBBLES[16] = {0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE, 0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF};
+// byte order reversal within 32 and 64 bit lanes
+alignas(16) static const uint8_t BYTE_SWAP_32[16] = {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+alignas(16) static const uint8_t BYTE_SWAP_64[16] = {7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8};
+
+__attribute__((target("avx2"))) static __m256i Broadcast(const uint8_t* table) {
+	return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table)));
+}
+
+__attribute__((target("avx2"))) static __m256i ReverseBitsAvx2(__m256i x, const uint8_t* byte_swap) {
+	const __m256i nibbles = _mm256_set1_epi8(0x0F);
+	__m256i low = _mm256_and_si256(x, nibbles);
+	__m256i high = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibbles);
+	x = _mm256_or_si256(_mm256_shuffle_epi8(Broadcast(REVERSED_LOW_NIBBLES), low),
+	                    _mm256_shuffle_epi8(Broadcast(REVERSED_HIGH_NIBBLES), high));
+	return _mm256_shuffle_epi8(x, Broadcast(byte_swap));
+}
+
+// GCC warns about the deliberately undefined source operand inside some AVX-512 intrinsics,
+// for all kernels down to MakeKeysAvx512()
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f,avx512bw"))) static __m512i Broadcast512(const uint8_t* table) {
+	return _mm512_broadcast_i32x4(_mm_load_si128(reinterpret_cast<const __m128i*>(table)));
+}
+
+__attribute__((target("avx512f,avx512bw"))) static __m512i ReverseBitsAvx512(__m512i x, const uint8_t* byte_swap) {
+	const __m512i nibbles = _mm512_set1_epi8(0x0F);
+	__m512i low = _mm512_and_si512(x, nibbles);
+	__m512i high = _mm512_and_si512(_mm512_srli_epi16(x, 4), nibbles);
+	x = _mm512_or_si512(_mm512_shuffle_epi8(Broadcast512(REVERSED_LOW_NIBBLES), low),
+	                    _mm512_shuffle_epi8(Broadcast512(REVERSED_HIGH_NIBBLES), high));
+	return _mm512_shuffle_epi8(x, Broadcast512(byte_swap));
+}
+
+/**
+ * @brief The mixer of HashValue() on eight values at once.
+ *
+ * @return size_t Number of values hashed, the rest is left to the scalar loop.
+ */
+__attribute__((target("avx2"))) static size_t HashMixerAvx2(uint64_t seed, const uint32_t* values, size_t count, uint32_t* hashes) {
+	const __m256i seeds = _mm256_set1_epi32((uint32_t)seed);
+	const __m256i factor = _mm256_set1_epi32(0x45d9f3b);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)), seeds);
+		x = _mm256_mullo_epi32(_mm256_xor_si256(_mm256_srli_epi32(x, 16), x), factor);
+		x = _mm256_mullo_epi32(_mm256_xor_si256(_mm256_srli_epi32(x, 16), x), factor);
+		x = _mm256_xor_si256(_mm256_srli_epi32(x, 16), x);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i), x);
+	}
+	return i;
+}
+
+__attribute__((target("avx512f"))) static size_t HashMixerAvx512(uint64_t seed, const uint32_t* values, size_t count, uint32_t* hashes) {
+	const __m512i seeds = _mm512_set1_epi32((uint32_t)seed);
+	const __m512i factor = _mm512_set1_epi32(0x45d9f3b);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m512i x = _mm512_xor_si512(_mm512_loadu_si512(values + i), seeds);
+		x = _mm512_mullo_epi32(_mm512_xor_si512(_mm512_srli_epi32(x, 16), x), factor);
+		x = _mm512_mullo_epi32(_mm512_xor_si512(_mm512_srli_epi32(x, 16), x), factor);
+		x = _mm512_xor_si512(_mm512_srli_epi32(x, 16), x);
+		_mm512_storeu_si512(hashes + i, x);
+	}
+	return i;
+}
+
+/**
+ * @brief The splitmix64 mixer of HashValue() on eight values at once, AVX2 has no 64 bit multiplication.
+ */
+__attribute__((target("avx512f,avx512dq"))) static size_t HashMixerAvx512(uint64_t seed, const uint64_t* values, size_t count, uint64_t* hashes) {
+	const __m512i seeds = _mm512_set1_epi64(seed);
+	const __m512i factor_0 = _mm512_set1_epi64(0xbf58476d1ce4e5b9);
+	const __m512i factor_1 = _mm512_set1_epi64(0x94d049bb133111eb);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m512i x = _mm512_xor_si512(_mm512_loadu_si512(values + i), seeds);
+		x = _mm512_mullo_epi64(_mm512_xor_si512(x, _mm512_srli_epi64(x, 30)), factor_0);
+		x = _mm512_mullo_epi64(_mm512_xor_si512(x, _mm512_srli_epi64(x, 27)), factor_1);
+		x = _mm512_xor_si512(x, _mm512_srli_epi64(x, 31));
+		_mm512_storeu_si512(hashes + i, x);
+	}
+	return i;
+}
+
+__attribute__((target("avx2"))) static size_t MakeKeysAvx2(const uint32_t* hashes, size_t count, uint32_t key_mask, uint32_t* keys) {
+	const __m256i masks = _mm256_set1_epi32(key_mask);
+	const __m256i high = _mm256_set1_epi32(0x80000000);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hashes + i));
+		x = _mm256_or_si256(_mm256_and_si256(x, masks), high);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(keys + i), ReverseBitsAvx2(x, BYTE_SWAP_32));
+	}
+	return i;
+}
+
+__attribute__((target("avx2"))) static size_t MakeKeysAvx2(const uint64_t* hashes, size_t count, uint64_t key_mask, uint64_t* keys) {
+	const __m256i masks = _mm256_set1_epi64x(key_mask);
+	const __m256i high = _mm256_set1_epi64x(0x8000000000000000);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hashes + i));
+		x = _mm256_or_si256(_mm256_and_si256(x, masks), high);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(keys + i), ReverseBitsAvx2(x, BYTE_SWAP_64));
+	}
+	return i;
+}
+
+__attribute__((target("avx512f,avx512bw"))) static size_t MakeKeysAvx512(const uint32_t* hashes, size_t count, uint32_t key_mask, uint32_t* keys) {
+	const __m512i masks = _mm512_set1_epi32(key_mask);
+	const __m512i high = _mm512_set1_epi32(0x80000000);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m512i x = _mm512_or_si512(_mm512_and_si512(_mm512_loadu_si512(hashes + i), masks), high);
+		_mm512_storeu_si512(keys + i, ReverseBitsAvx512(x, BYTE_SWAP_32));
+	}
+	return i;
+}
+
+__attribute__((target("avx512f,avx512bw"))) static size_t MakeKeysAvx512(const uint64_t* hashes, size_t count, uint64_t key_mask, uint64_t* keys) {
+	const __m512i masks = _mm512_set1_epi64(key_mask);
+	const __m512i high = _mm512_set1_epi64(0x8000000000000000);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m512i x = _mm512_or_si512(_mm512_and_si512(_mm512_loadu_si512(hashes + i), masks), high);
+		_mm512_storeu_si512(keys + i, ReverseBitsAvx512(x, BYTE_SWAP_64));
+	}
+	return i;
+}
+#pragma GCC diagnostic pop
+
+/**
+ * @brief Scalar loops for whatever the vector kernels left over.
+ */
+template <typename T>
+static void PrepareKeysScalar(HashKind hash_kind, uint64_t seed, const T* values, size_t hashed, size_t keyed, size_t count, T key_mask, T* hashes, T* keys) {
+	const T high = (T)1 << (sizeof(T) * 8 - 1);
+	for (size_t i = hashed; i < count; i++)
+		hashes[i] = HashValue(hash_kind, seed, values[i]);
+	for (size_t i = keyed; i < count; i++)
+		keys[i] = ReverseBits((T)((hashes[i] & key_mask) | high));
+}
+
+SimdLevel GetSimdLevel() {
+	return simd_level;
+}
+
+SimdLevel GetSupportedSimdLevel() {
+	return supported_simd_level;
+}
+
+/**
+ * @brief Use at most the given instruction set from now on, for comparing the kernels.
+ * Not meant to be called while other threads prepare keys.
+ *
+ * @param level
+ */
+void SetSimdLevel(SimdLevel level) {
+	simd_level = level < supported_simd_level ? level : supported_simd_level;
+}
+
+void PrepareKeys(HashKind hash_kind, uint64_t seed, const uint32_t* values, size_t count, uint32_t key_mask, uint32_t* hashes, uint32_t* keys) {
+	size_t hashed = 0;
+	if (hash_kind == HashKind::MIXER && simd_level == SimdLevel::AVX512)
+		hashed = HashMixerAvx512(seed, values, count, hashes);
+	else if (hash_kind == HashKind::MIXER && simd_level == SimdLevel::AVX2)
+		hashed = HashMixerAvx2(seed, values, count, hashes);
+	PrepareKeysScalar(hash_kind, seed, values, hashed, count, count, key_mask, hashes, keys);
+
+	size_t keyed = 0;
+	if (simd_level == SimdLevel::AVX512)
+		keyed = MakeKeysAvx512(hashes, count, key_mask, keys);
+	else if (simd_level == SimdLevel::AVX2)
+		keyed = MakeKeysAvx2(hashes, count, key_mask, keys);
+	PrepareKeysScalar(hash_kind, seed, values, count, keyed, count, key_mask, hashes, keys);
+}
+
+void PrepareKeys(HashKind hash_kind, uint64_t seed, const uint64_t* values, size_t count, uint64_t key_mask, uint64_t* hashes, uint64_t* keys) {
+	size_t hashed = 0;
+	if (hash_kind == HashKind::MIXER && simd_level == SimdLevel::AVX512)
+		hashed = HashMixerAvx512(seed, values, count, hashes);
+	PrepareKeysScalar(hash_kind, seed, values, hashed, count, count, key_mask, hashes, keys);
+
+	size_t keyed = 0;
+	if (simd_level == SimdLevel::AVX512)
+		keyed = MakeKeysAvx512(hashes, count, key_mask, keys);
+	else if (simd_level == SimdLevel::AVX2)
+		keyed = MakeKeysAvx2(hashes, count, key_mask, keys);
+	PrepareKeysScalar(hash_kind, seed, values, count, keyed, count, key_mask, hashes, keys);
+}
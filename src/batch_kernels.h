@@ -0,0 +1,32 @@
+#ifndef BATCH_KERNELS_H
+#define BATCH_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash_functions.h"
+
+/**
+ * Instruction sets the key preparation of the batch operations can use. The best one the CPU
+ * supports is picked at startup, SetSimdLevel() can only go lower than that.
+ */
+enum class SimdLevel {
+	SCALAR,
+	AVX2,
+	AVX512
+};
+
+SimdLevel GetSimdLevel();
+SimdLevel GetSupportedSimdLevel();
+void SetSimdLevel(SimdLevel level);
+
+/**
+ * @brief Prepare the split-order keys of a batch of values: hashes[i] gets the hash of values[i]
+ * and keys[i] the reversed hash, masked with key_mask and with the top bit set, the normal key of
+ * the split-ordered list. The mixer is vectorized (64 bit values need AVX-512), the masking and
+ * bit reversal are vectorized for every hash function. Same results as HashValue() and ReverseBits().
+ */
+void PrepareKeys(HashKind hash_kind, uint64_t seed, const uint32_t* values, size_t count, uint32_t key_mask, uint32_t* hashes, uint32_t* keys);
+void PrepareKeys(HashKind hash_kind, uint64_t seed, const uint64_t* values, size_t count, uint64_t key_mask, uint64_t* hashes, uint64_t* keys);
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef BUCKET_DIRECTORY_H
+#define BUCKET_DIRECTORY_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+/**
+ * Two level bucket directory of a split-ordered hashtable. Segment 0 holds the buckets
+ * 0 and 1, segment i > 0 holds the buckets [2^i, 2^(i+1)). Segments are allocated when a
+ * bucket in them is first stored and never move, so growing the directory only bumps the
+ * cached bucket mask and nothing is ever copied.
+ * Entries are nullptr until their bucket gets initialized.
+ */
+template <typename Node>
+class BucketDirectory {
+   private:
+	static const uint32_t MAX_SEGMENTS = 32;
+	std::atomic<std::atomic<Node*>*> segments[MAX_SEGMENTS];
+	std::atomic<uint32_t> bucket_mask;  // number of buckets - 1
+
+	/**
+	 * @brief Segment holding a bucket, i.e. the position of its most significant bit.
+	 */
+	static uint32_t GetSegment(uint32_t bucket) {
+		return bucket < 2 ? 0 : 31 - __builtin_clz(bucket);
+	}
+
+	/**
+	 * @brief Position of a bucket inside its segment, i.e. the bucket without its most significant bit.
+	 */
+	static uint32_t GetOffset(uint32_t bucket, uint32_t segment) {
+		return segment == 0 ? bucket : bucket ^ (1u << segment);
+	}
+
+	static uint32_t GetSegmentSize(uint32_t segment) {
+		return segment == 0 ? 2 : 1u << segment;
+	}
+
+   public:
+	explicit BucketDirectory(uint32_t number_of_buckets = 2) : bucket_mask(number_of_buckets - 1) {
+		for (uint32_t i = 0; i < MAX_SEGMENTS; i++)
+			segments[i].store(nullptr, std::memory_order_relaxed);
+	}
+
+	~BucketDirectory() {
+		for (uint32_t i = 0; i < MAX_SEGMENTS; i++)
+			delete[] segments[i].load(std::memory_order_relaxed);
+	}
+
+	BucketDirectory(const BucketDirectory& bucket_directory) = delete;
+	BucketDirectory& operator=(const BucketDirectory& a) = delete;
+
+	uint32_t GetMask() {
+		return bucket_mask.load(std::memory_order_acquire);
+	}
+
+	uint32_t GetNumberOfBuckets() {
+		return GetMask() + 1;
+	}
+
+	/**
+	 * @brief Bytes taken by the allocated segments.
+	 */
+	size_t GetMemoryUsage() {
+		size_t bytes = 0;
+		for (uint32_t i = 0; i < MAX_SEGMENTS; i++) {
+			if (segments[i].load(std::memory_order_acquire) != nullptr)
+				bytes += GetSegmentSize(i) * sizeof(std::atomic<Node*>);
+		}
+		return bytes;
+	}
+
+	/**
+	 * @brief Double the number of buckets, unless someone else already did.
+	 *
+	 * @param expected_mask The mask the caller based its decision on.
+	 * @return true if we doubled the directory
+	 */
+	bool Grow(uint32_t expected_mask) {
+		return bucket_mask.compare_exchange_strong(expected_mask, (expected_mask << 1) | 1);
+	}
+
+	/**
+	 * @brief Halve the number of buckets, unless someone else already changed it.
+	 * The segment of the upper half stays allocated until DetachSegment().
+	 *
+	 * @param expected_mask The mask the caller based its decision on.
+	 * @return true if we halved the directory
+	 */
+	bool Shrink(uint32_t expected_mask) {
+		return bucket_mask.compare_exchange_strong(expected_mask, expected_mask >> 1);
+	}
+
+	/**
+	 * @brief Take away the segment of the buckets above mask, once a shrink to mask has cleared
+	 * them. Threads that loaded it before might still read it, so the caller frees it with
+	 * DeleteSegment() when they are done. A later Store() allocates the segment again.
+	 *
+	 * @param mask The current mask, at least 1.
+	 * @return std::atomic<Node*>* the detached segment, nullptr if it was not allocated
+	 */
+	std::atomic<Node*>* DetachSegment(uint32_t mask) {
+		return segments[GetSegment(mask + 1)].exchange(nullptr);
+	}
+
+	static void DeleteSegment(void* entries) {
+		delete[] static_cast<std::atomic<Node*>*>(entries);
+	}
+
+	/**
+	 * @brief Return the sentinel node of a bucket or nullptr if it is not initialized yet.
+	 */
+	Node* Load(uint32_t bucket) {
+		uint32_t segment = GetSegment(bucket);
+		std::atomic<Node*>* entries = segments[segment].load(std::memory_order_acquire);
+		if (entries == nullptr)
+			return nullptr;
+		return entries[GetOffset(bucket, segment)].load(std::memory_order_acquire);
+	}
+
+	/**
+	 * @brief Prefetch the entry of a bucket, so a later Load() does not stall on it.
+	 */
+	void Prefetch(uint32_t bucket) {
+		uint32_t segment = GetSegment(bucket);
+		std::atomic<Node*>* entries = segments[segment].load(std::memory_order_acquire);
+		if (entries != nullptr)
+			__builtin_prefetch(&entries[GetOffset(bucket, segment)]);
+	}
+
+	/**
+	 * @brief Set the sentinel node of a bucket, allocating its segment if necessary.
+	 * Sequentially consistent: a thread that stores a node and then checks whether it got
+	 * marked and a shrink that marks it and then clears the entry cannot both miss each other.
+	 */
+	void Store(uint32_t bucket, Node* node) {
+		uint32_t segment = GetSegment(bucket);
+		std::atomic<Node*>* entries = segments[segment].load(std::memory_order_acquire);
+		if (entries == nullptr) {
+			std::atomic<Node*>* new_entries = new std::atomic<Node*>[GetSegmentSize(segment)]();
+			if (segments[segment].compare_exchange_strong(entries, new_entries))
+				entries = new_entries;
+			else
+				delete[] new_entries;  // entries now holds the segment of the thread that won
+		}
+		entries[GetOffset(bucket, segment)].store(node);
+	}
+
+	/**
+	 * @brief Replace the sentinel node of an initialized bucket, if it is still expected.
+	 */
+	bool CompareAndStore(uint32_t bucket, Node* expected, Node* node) {
+		uint32_t segment = GetSegment(bucket);
+		std::atomic<Node*>* entries = segments[segment].load(std::memory_order_acquire);
+		if (entries == nullptr)
+			return false;  // detached since the caller loaded expected
+		return entries[GetOffset(bucket, segment)].compare_exchange_strong(expected, node);
+	}
+};
+
+#endif
@@ -0,0 +1,509 @@
+/**
+ * @file cuckoo_hashtable.cpp
+ * @author Josef Salzmann &	Aleksandar Hadzhiyski
+ * @brief Bucketized cuckoo hashtable with optimistic lock-free reads and bucket locks for writers.
+ * @date 2026-10-15
+ */
+#include "cuckoo_hashtable.h"
+
+#include <immintrin.h>
+
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#include "backoff.h"
+#include "epoch_reclamation.h"
+
+/**
+ * @brief Construct a new table with INITIAL_SIZE empty buckets.
+ *
+ * @param hash_kind Hash function used for the values.
+ * @param seed Seed of the hash function, random unless given.
+ */
+CuckooHashTable::CuckooHashTable(HashKind hash_kind, uint64_t seed) : hash_kind(hash_kind), seed(seed), bucket_array(new CuckooBucketArray(INITIAL_SIZE)) {}
+
+/**
+ * @brief Free the buckets, and the array of an unfinished migration. Only safe once no other
+ * thread accesses the table.
+ */
+CuckooHashTable::~CuckooHashTable() {
+	CuckooBucketArray* array = bucket_array.load();
+	while (array != nullptr) {
+		CuckooBucketArray* next = array->next.load();
+		delete array;
+		array = next;
+	}
+}
+
+KeyType CuckooHashTable::HashFunction(ValueType value) {
+	return HashValue(hash_kind, seed, value);
+}
+
+uint32_t CuckooHashTable::GetPrimaryBucket(const CuckooBucketArray* array, KeyType hash) {
+	return (uint32_t)hash & array->mask;
+}
+
+/**
+ * @brief The other bucket of a key, from either of its two buckets. XORing an offset derived
+ * from the top bits of the hash maps the two buckets onto each other. The offset is odd, so the
+ * two buckets differ as soon as there is more than one.
+ *
+ * @param array
+ * @param bucket One of the buckets of the key.
+ * @param hash Hash of the key.
+ * @return uint32_t
+ */
+uint32_t CuckooHashTable::GetAlternateBucket(const CuckooBucketArray* array, uint32_t bucket, KeyType hash) {
+	uint32_t tag = (uint32_t)(hash >> (sizeof(KeyType) * 8 - 8)) + 1;
+	return (bucket ^ ((tag * 0x5bd1e995) | 1)) & array->mask;
+}
+
+/**
+ * @brief Lock a bucket by making its version odd. Stores to the bucket after this cannot become
+ * visible before the odd version, so optimistic readers notice them.
+ *
+ * @param bucket
+ */
+void CuckooHashTable::LockBucket(CuckooBucket* bucket) {
+	Backoff backoff(4, 1024);
+	uint32_t attempts = 0;
+	while (true) {
+		uint32_t version = bucket->version.load(std::memory_order_relaxed);
+		if (!(version & 1) && bucket->version.compare_exchange_weak(version, version + 1, std::memory_order_acquire))
+			break;
+		backoff.Pause();
+		if (++attempts % 16 == 0)
+			std::this_thread::yield();  // the holder might not be running
+	}
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+void CuckooHashTable::UnlockBucket(CuckooBucket* bucket) {
+	bucket->version.store(bucket->version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Lock two buckets in index order, so writers cannot deadlock. The buckets may be the same.
+ *
+ * @param array
+ * @param first
+ * @param second
+ */
+void CuckooHashTable::LockBuckets(CuckooBucketArray* array, uint32_t first, uint32_t second) {
+	if (first > second)
+		std::swap(first, second);
+	LockBucket(&array->buckets[first]);
+	if (second != first)
+		LockBucket(&array->buckets[second]);
+}
+
+void CuckooHashTable::UnlockBuckets(CuckooBucketArray* array, uint32_t first, uint32_t second) {
+	UnlockBucket(&array->buckets[first]);
+	if (second != first)
+		UnlockBucket(&array->buckets[second]);
+}
+
+/**
+ * @brief Slot of a bucket that holds key.
+ *
+ * @param bucket
+ * @param key
+ * @return int the slot, -1 if the key is not in the bucket
+ */
+int CuckooHashTable::FindSlot(CuckooBucket* bucket, ValueType key) {
+	uint32_t occupied = bucket->occupied.load(std::memory_order_relaxed) & ~CuckooBucket::MIGRATED;
+	while (occupied != 0) {
+		int slot = __builtin_ctz(occupied);
+		if (bucket->keys[slot].load(std::memory_order_relaxed) == key)
+			return slot;
+		occupied &= occupied - 1;
+	}
+	return -1;
+}
+
+int CuckooHashTable::FindFreeSlot(CuckooBucket* bucket) {
+	uint32_t free = ~bucket->occupied.load(std::memory_order_relaxed) & ((1u << CuckooBucket::SLOTS) - 1);
+	return free == 0 ? -1 : __builtin_ctz(free);
+}
+
+void CuckooHashTable::PutKey(CuckooBucket* bucket, int slot, ValueType key) {
+	bucket->keys[slot].store(key, std::memory_order_relaxed);
+	bucket->occupied.store(bucket->occupied.load(std::memory_order_relaxed) | (1u << slot), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Whether the keys of a bucket have been copied to the next array. Writers must not change
+ * such a bucket anymore, its keys are only still there for readers.
+ */
+bool CuckooHashTable::IsMigrated(CuckooBucket* bucket) {
+	return bucket->occupied.load(std::memory_order_relaxed) & CuckooBucket::MIGRATED;
+}
+
+/**
+ * @brief Breadth-first search for the shortest cuckoo path that frees a slot in one of the two
+ * buckets of a new key. Runs without locks, so the path may be stale by the time it gets moved.
+ *
+ * @param array
+ * @param first Primary bucket of the new key.
+ * @param second Alternate bucket of the new key.
+ * @param path Visited steps, at least MAX_SEARCH of them.
+ * @param length Number of visited steps.
+ * @return int32_t the step whose bucket has a free slot, -1 if there is none within MAX_SEARCH buckets
+ */
+int32_t CuckooHashTable::SearchPath(CuckooBucketArray* array, uint32_t first, uint32_t second, CuckooStep* path, uint32_t& length) {
+	length = 0;
+	path[length++] = {first, -1, 0};
+	if (second != first)
+		path[length++] = {second, -1, 0};
+	for (uint32_t i = 0; i < length; i++) {
+		CuckooBucket* bucket = &array->buckets[path[i].bucket];
+		if (FindFreeSlot(bucket) >= 0)
+			return (int32_t)i;
+		for (uint32_t slot = 0; slot < CuckooBucket::SLOTS && length < MAX_SEARCH; slot++) {
+			uint32_t alternate = GetAlternateBucket(array, path[i].bucket, HashFunction(bucket->keys[slot].load(std::memory_order_relaxed)));
+			if (alternate != path[i].bucket)
+				path[length++] = {alternate, (int32_t)i, slot};
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Move the keys of a cuckoo path back to front, each one under the locks of the bucket it
+ * leaves and the bucket it enters. The key is put into its new bucket before it leaves the old
+ * one, and readers retry on both version changes anyway, so the key never seems to be missing.
+ *
+ * @param array
+ * @param path
+ * @param end Step whose bucket has a free slot.
+ * @return true if the whole path was moved
+ * @return false if some step was stale
+ */
+bool CuckooHashTable::MovePath(CuckooBucketArray* array, CuckooStep* path, int32_t end) {
+	for (int32_t step = end; path[step].parent >= 0; step = path[step].parent) {
+		const CuckooStep& to = path[step];
+		const CuckooStep& from = path[to.parent];
+		LockBuckets(array, from.bucket, to.bucket);
+		CuckooBucket* source = &array->buckets[from.bucket];
+		CuckooBucket* target = &array->buckets[to.bucket];
+		bool moved = false;
+		int free = IsMigrated(source) || IsMigrated(target) ? -1 : FindFreeSlot(target);
+		if (free >= 0 && (source->occupied.load(std::memory_order_relaxed) & (1u << to.slot))) {
+			ValueType key = source->keys[to.slot].load(std::memory_order_relaxed);
+			if (GetAlternateBucket(array, from.bucket, HashFunction(key)) == to.bucket) {
+				PutKey(target, free, key);
+				source->occupied.store(source->occupied.load(std::memory_order_relaxed) & ~(1u << to.slot), std::memory_order_relaxed);
+				moved = true;
+			}
+		}
+		UnlockBuckets(array, from.bucket, to.bucket);
+		if (!moved)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Put a key into array, or into the array its buckets got migrated to. If both buckets
+ * are full we make room by moving other keys or resize; while a migration is running the key
+ * just goes to the new array.
+ *
+ * @param array
+ * @param value
+ * @param hash HashFunction(value)
+ * @param resize Whether we may take on a whole migration, not while we hold a bucket of an older array.
+ * @return true
+ * @return false if the key is already in the table
+ */
+bool CuckooHashTable::Insert(CuckooBucketArray* array, ValueType value, KeyType hash, bool resize) {
+	CuckooStep path[MAX_SEARCH];
+	while (true) {
+		uint32_t first = GetPrimaryBucket(array, hash);
+		uint32_t second = GetAlternateBucket(array, first, hash);
+		LockBuckets(array, first, second);
+		CuckooBucket* primary = &array->buckets[first];
+		CuckooBucket* alternate = &array->buckets[second];
+		if (IsMigrated(primary) || IsMigrated(alternate)) {
+			UnlockBuckets(array, first, second);
+			array = Forward(array, first, second);
+			continue;
+		}
+		if (FindSlot(primary, value) >= 0 || FindSlot(alternate, value) >= 0) {
+			UnlockBuckets(array, first, second);
+			return false;
+		}
+		CuckooBucket* target = primary;
+		int slot = FindFreeSlot(primary);
+		if (slot < 0) {
+			target = alternate;
+			slot = FindFreeSlot(alternate);
+		}
+		if (slot >= 0) {
+			PutKey(target, slot, value);
+			UnlockBuckets(array, first, second);
+			return true;
+		}
+		UnlockBuckets(array, first, second);
+		if (array->next.load(std::memory_order_acquire) != nullptr) {
+			array = Forward(array, first, second);
+			continue;
+		}
+		uint32_t length;
+		int32_t end = SearchPath(array, first, second, path, length);
+		if (end >= 0)
+			MovePath(array, path, end);
+		else if (resize)
+			Resize(array, (array->mask + 1) * 2);
+		else
+			StartMigration(array, (array->mask + 1) * 2);
+	}
+}
+
+/**
+ * @brief Link an empty array of size buckets behind array, unless someone else already did.
+ * From then on the buckets of array get migrated to it.
+ *
+ * @param array
+ * @param size At least twice the size of array.
+ */
+void CuckooHashTable::StartMigration(CuckooBucketArray* array, uint32_t size) {
+	if (array->next.load(std::memory_order_acquire) != nullptr)
+		return;
+	CuckooBucketArray* next = new CuckooBucketArray(size);
+	CuckooBucketArray* expected = nullptr;
+	if (!array->next.compare_exchange_strong(expected, next))
+		delete next;
+}
+
+/**
+ * @brief Copy the keys of a bucket to the next array and mark it migrated, under its lock, so
+ * only its own readers and writers wait meanwhile. The keys stay in the bucket: a key whose
+ * other bucket is not migrated yet is still looked up here, and nobody can change it in the new
+ * array before that one is migrated as well.
+ *
+ * @param array An array with a next array.
+ * @param bucket
+ */
+void CuckooHashTable::MigrateBucket(CuckooBucketArray* array, uint32_t bucket) {
+	CuckooBucket* source = &array->buckets[bucket];
+	LockBucket(source);
+	uint32_t occupied = source->occupied.load(std::memory_order_relaxed);
+	if (occupied & CuckooBucket::MIGRATED) {
+		UnlockBucket(source);
+		return;
+	}
+	CuckooBucketArray* next = array->next.load(std::memory_order_acquire);
+	for (uint32_t keys = occupied; keys != 0; keys &= keys - 1) {
+		ValueType key = source->keys[__builtin_ctz(keys)].load(std::memory_order_relaxed);
+		Insert(next, key, HashFunction(key), false);
+	}
+	source->occupied.store(occupied | CuckooBucket::MIGRATED, std::memory_order_relaxed);
+	UnlockBucket(source);
+	if (array->migrated.fetch_add(1) == array->mask)
+		FinishMigration(array);
+}
+
+/**
+ * @brief Make sure both buckets of a key are migrated, then the key lives in the next array.
+ *
+ * @param array An array with a next array.
+ * @param first
+ * @param second
+ * @return CuckooBucketArray* the next array
+ */
+CuckooBucketArray* CuckooHashTable::Forward(CuckooBucketArray* array, uint32_t first, uint32_t second) {
+	MigrateBucket(array, first);
+	MigrateBucket(array, second);
+	return array->next.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Cooperative part of a migration, like the resizing of the split-ordered table: claim
+ * the next MIGRATE_CHUNK_SIZE buckets of array and migrate them.
+ *
+ * @param array An array with a next array.
+ * @return true
+ * @return false if every bucket has already been claimed
+ */
+bool CuckooHashTable::HelpMigrate(CuckooBucketArray* array) {
+	uint32_t first = array->migrate_cursor.load();
+	while (first <= array->mask) {
+		uint32_t last = std::min(first + MIGRATE_CHUNK_SIZE, array->mask + 1);
+		if (!array->migrate_cursor.compare_exchange_weak(first, last))
+			continue;
+		for (uint32_t bucket = first; bucket < last; bucket++)
+			MigrateBucket(array, bucket);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Replace a completely migrated array by its next one and retire it. If an older array
+ * is still being migrated, its last migrating thread does this for us afterwards, so arrays get
+ * replaced in order. The caller is inside an epoch.
+ *
+ * @param array
+ */
+void CuckooHashTable::FinishMigration(CuckooBucketArray* array) {
+	while (array->migrated.load() == array->mask + 1) {
+		CuckooBucketArray* next = array->next.load();
+		CuckooBucketArray* expected = array;
+		if (!bucket_array.compare_exchange_strong(expected, next))
+			return;
+		EpochReclamation::Retire(array, &DeleteBucketArray);
+		array = next;
+	}
+}
+
+/**
+ * @brief Grow to size buckets and migrate every bucket that is not claimed by someone else yet.
+ * Nobody waits for us except readers and writers of the one bucket we migrate at a time.
+ * The caller is inside an epoch.
+ *
+ * @param array Array the caller found too small.
+ * @param size
+ */
+void CuckooHashTable::Resize(CuckooBucketArray* array, uint32_t size) {
+	StartMigration(array, size);
+	while (HelpMigrate(array)) {
+	}
+}
+
+void CuckooHashTable::DeleteBucketArray(void* bucket_array) {
+	delete static_cast<CuckooBucketArray*>(bucket_array);
+}
+
+/**
+ * @brief Add an element to the hashtable. Takes a free slot of one of its two buckets, after
+ * moving other keys out of the way if both are full, or after doubling the table if that fails.
+ * While the table is resized, every writer migrates a few buckets first.
+ *
+ * @param value Value to be added to the hashtable.
+ * @return true
+ * @return false
+ */
+bool CuckooHashTable::Add(ValueType value) {
+	EpochGuard guard;
+	KeyType hash = HashFunction(value);
+	CuckooBucketArray* array = bucket_array.load(std::memory_order_acquire);
+	if (array->next.load(std::memory_order_relaxed) != nullptr)
+		HelpMigrate(array);
+	if (!Insert(array, value, hash, true))
+		return false;
+	table_size.Add(1);
+	return true;
+}
+
+/**
+ * @brief Remove an element from the hashtable by clearing its slot.
+ *
+ * @param value Value to be removed from the hashtable.
+ * @return true
+ * @return false
+ */
+bool CuckooHashTable::Remove(ValueType value) {
+	EpochGuard guard;
+	KeyType hash = HashFunction(value);
+	CuckooBucketArray* array = bucket_array.load(std::memory_order_acquire);
+	if (array->next.load(std::memory_order_relaxed) != nullptr)
+		HelpMigrate(array);
+	while (true) {
+		uint32_t first = GetPrimaryBucket(array, hash);
+		uint32_t second = GetAlternateBucket(array, first, hash);
+		LockBuckets(array, first, second);
+		if (IsMigrated(&array->buckets[first]) || IsMigrated(&array->buckets[second])) {
+			UnlockBuckets(array, first, second);
+			array = Forward(array, first, second);
+			continue;
+		}
+		bool ret = false;
+		for (CuckooBucket* bucket : {&array->buckets[first], &array->buckets[second]}) {
+			int slot = FindSlot(bucket, value);
+			if (slot >= 0) {
+				bucket->occupied.store(bucket->occupied.load(std::memory_order_relaxed) & ~(1u << slot), std::memory_order_relaxed);
+				ret = true;
+				break;
+			}
+		}
+		UnlockBuckets(array, first, second);
+		if (ret)
+			table_size.Add(-1);
+		return ret;
+	}
+}
+
+/**
+ * @brief Check if an element is in the hashtable, reading at most its two buckets. Retries if
+ * a writer held either bucket meanwhile. Once both buckets are migrated we follow to the next
+ * array, until then the old buckets are up to date for our key.
+ *
+ * @param value Value to be checked.
+ * @return true
+ * @return false
+ */
+bool CuckooHashTable::Contains(ValueType value) {
+	EpochGuard guard;
+	KeyType hash = HashFunction(value);
+	CuckooBucketArray* array = bucket_array.load(std::memory_order_acquire);
+	while (true) {
+		uint32_t first = GetPrimaryBucket(array, hash);
+		CuckooBucket* primary = &array->buckets[first];
+		CuckooBucket* alternate = &array->buckets[GetAlternateBucket(array, first, hash)];
+		uint32_t primary_version = primary->version.load(std::memory_order_acquire);
+		uint32_t alternate_version = alternate->version.load(std::memory_order_acquire);
+		if ((primary_version | alternate_version) & 1) {
+			_mm_pause();
+			continue;
+		}
+		bool forward = IsMigrated(primary) && IsMigrated(alternate);
+		bool ret = !forward && (FindSlot(primary, value) >= 0 || FindSlot(alternate, value) >= 0);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (primary->version.load(std::memory_order_relaxed) != primary_version || alternate->version.load(std::memory_order_relaxed) != alternate_version)
+			continue;
+		if (!forward)
+			return ret;
+		array = array->next.load(std::memory_order_acquire);
+	}
+}
+
+size_t CuckooHashTable::Size() {
+	int64_t size = table_size.GetExact();
+	return size < 0 ? 0 : (size_t)size;
+}
+
+/**
+ * @brief Grow the table to enough buckets for expected_size elements at 90 percent load.
+ *
+ * @param expected_size
+ */
+void CuckooHashTable::Reserve(size_t expected_size) {
+	EpochGuard guard;
+	uint32_t size = INITIAL_SIZE;
+	while ((size_t)size * CuckooBucket::SLOTS * 9 / 10 < expected_size)
+		size *= 2;
+	CuckooBucketArray* array = bucket_array.load(std::memory_order_acquire);
+	if (size > array->mask + 1)
+		Resize(array, size);
+}
+
+/**
+ * @brief Return the buckets holding keys, for debugging. A migration that was left unfinished
+ * is shown as well: every key is in exactly one bucket that is not migrated.
+ */
+std::string CuckooHashTable::ToString() {
+	std::stringstream ss;
+	for (CuckooBucketArray* array = bucket_array.load(); array != nullptr; array = array->next.load()) {
+		for (uint32_t i = 0; i <= array->mask; i++) {
+			uint32_t occupied = array->buckets[i].occupied.load();
+			if (occupied == 0 || (occupied & CuckooBucket::MIGRATED))
+				continue;
+			ss << "Bucket " << i << ": ";
+			for (; occupied != 0; occupied &= occupied - 1)
+				ss << "(Value " << array->buckets[i].keys[__builtin_ctz(occupied)].load() << ") ";
+			ss << "\n";
+		}
+	}
+	return ss.str();
+}
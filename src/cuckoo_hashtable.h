@@ -0,0 +1,111 @@
+#ifndef CUCKOO_HASHTABLE_H
+#define CUCKOO_HASHTABLE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include "hash_functions.h"
+#include "lock_free_hashtable.h"
+#include "striped_counter.h"
+
+/**
+ * Bucket of the cuckoo table, exactly one cache line. The version doubles as the lock of the
+ * bucket: it is odd while a writer holds the bucket. The keys are atomic only so optimistic
+ * readers may read them while a writer changes them.
+ */
+struct alignas(64) CuckooBucket {
+	static const uint32_t SLOTS = (64 - 2 * sizeof(uint32_t)) / sizeof(ValueType);
+	static const uint32_t MIGRATED = 1u << 31;  // set in occupied once the keys have been copied to the next array
+	std::atomic<uint32_t> version;
+	std::atomic<uint32_t> occupied;  // bit i is set if keys[i] holds a key
+	std::atomic<ValueType> keys[SLOTS];
+};
+
+static_assert(sizeof(CuckooBucket) == 64, "cuckoo buckets should fill exactly one cache line");
+static_assert(CuckooBucket::SLOTS < 31, "the migrated flag shares the word with the occupied slots");
+
+struct CuckooBucketArray {
+	const uint32_t mask;  // number of buckets - 1
+	CuckooBucket* const buckets;
+	std::atomic<CuckooBucketArray*> next;  // array the buckets get migrated to, nullptr unless resizing
+	std::atomic<uint32_t> migrate_cursor;  // every bucket below has been migrated or claimed by a helping thread
+	std::atomic<uint32_t> migrated;  // number of migrated buckets
+
+	explicit CuckooBucketArray(uint32_t size) : mask(size - 1), buckets(new CuckooBucket[size]()), next(nullptr), migrate_cursor(0), migrated(0) {}
+	~CuckooBucketArray() {
+		delete[] buckets;
+	}
+	CuckooBucketArray(const CuckooBucketArray& cuckoo_bucket_array) = delete;
+	CuckooBucketArray& operator=(const CuckooBucketArray& a) = delete;
+};
+
+/**
+ * One step of a cuckoo path: the key in slot of the parent step's bucket moves to bucket.
+ */
+struct CuckooStep {
+	uint32_t bucket;
+	int32_t parent;  // index of the previous step, -1 for the two buckets of the new key
+	uint32_t slot;
+};
+
+/**
+ * Bucketized cuckoo hashing for read-dominated workloads. Every key lives in one of two buckets
+ * of a cache line each, so Contains reads at most two cache lines whatever the load. Readers
+ * never lock: they read the versions of both buckets, scan them and retry if a version changed
+ * meanwhile. Writers lock the two buckets of their key in index order. If both are full, a
+ * breadth-first search finds a short path of keys that can move to their other bucket, the keys
+ * are moved one at a time, back to front, each move under the locks of its two buckets.
+ * If no path exists, the table doubles without stopping the others: the new array gets linked
+ * behind the old one and the buckets are migrated one at a time, by the resizing thread and by
+ * every writer that comes along. A migrated bucket keeps its keys, so readers stay in the old
+ * array until both buckets of their key are migrated, and only then follow to the new one, as
+ * do the writers. Once every bucket is migrated the new array replaces the old one, which gets
+ * retired with epochs.
+ */
+class CuckooHashTable : public HashTable {
+   private:
+	static const uint32_t INITIAL_SIZE = 16;  // buckets
+	static const uint32_t MAX_SEARCH = 512;  // buckets visited by the search for a cuckoo path
+	static const uint32_t MIGRATE_CHUNK_SIZE = 16;  // buckets a writer migrates at once when helping with a resize
+	const HashKind hash_kind;
+	const uint64_t seed;
+	std::atomic<CuckooBucketArray*> bucket_array;
+	StripedCounter table_size;  // number of elements in the table
+	KeyType HashFunction(ValueType value);
+	static uint32_t GetPrimaryBucket(const CuckooBucketArray* array, KeyType hash);
+	static uint32_t GetAlternateBucket(const CuckooBucketArray* array, uint32_t bucket, KeyType hash);
+	static void LockBucket(CuckooBucket* bucket);
+	static void UnlockBucket(CuckooBucket* bucket);
+	static void LockBuckets(CuckooBucketArray* array, uint32_t first, uint32_t second);
+	static void UnlockBuckets(CuckooBucketArray* array, uint32_t first, uint32_t second);
+	static int FindSlot(CuckooBucket* bucket, ValueType key);
+	static int FindFreeSlot(CuckooBucket* bucket);
+	static void PutKey(CuckooBucket* bucket, int slot, ValueType key);
+	static bool IsMigrated(CuckooBucket* bucket);
+	int32_t SearchPath(CuckooBucketArray* array, uint32_t first, uint32_t second, CuckooStep* path, uint32_t& length);
+	bool MovePath(CuckooBucketArray* array, CuckooStep* path, int32_t end);
+	bool Insert(CuckooBucketArray* array, ValueType value, KeyType hash, bool resize);
+	void StartMigration(CuckooBucketArray* array, uint32_t size);
+	void MigrateBucket(CuckooBucketArray* array, uint32_t bucket);
+	CuckooBucketArray* Forward(CuckooBucketArray* array, uint32_t first, uint32_t second);
+	bool HelpMigrate(CuckooBucketArray* array);
+	void FinishMigration(CuckooBucketArray* array);
+	void Resize(CuckooBucketArray* array, uint32_t size);
+	static void DeleteBucketArray(void* bucket_array);
+
+   public:
+	explicit CuckooHashTable(HashKind hash_kind = HashKind::MIXER, uint64_t seed = RandomSeed());
+	CuckooHashTable(const CuckooHashTable& cuckoo_hashtable) = delete;
+	CuckooHashTable& operator=(const CuckooHashTable& a) = delete;
+	~CuckooHashTable() override;
+	bool Add(ValueType value) override;
+	bool Remove(ValueType value) override;
+	bool Contains(ValueType value) override;
+	size_t Size() override;
+	void Reserve(size_t expected_size) override;
+	std::string ToString() override;
+};
+
+#endif
@@ -0,0 +1,163 @@
+/**
+ * @file epoch_reclamation.cpp
+ * @author Josef Salzmann &	Aleksandar Hadzhiyski
+ * @brief Epoch based memory reclamation. Every thread owns a record with its announced
+ * epoch and three bags of retired pointers, one per epoch modulo three.
+ * @date 2026-10-15
+ */
+#include "epoch_reclamation.h"
+
+std::atomic<uint64_t> EpochReclamation::global_epoch(2);  // bags start out tagged with epoch 0, which is safe to free
+std::atomic<EpochRecord*> EpochReclamation::records(nullptr);
+
+/**
+ * @brief Gives the record back to the global list once its thread terminates.
+ */
+struct EpochRecordOwner {
+	EpochRecord* record = nullptr;
+	~EpochRecordOwner() {
+		if (record != nullptr)
+			EpochReclamation::ReleaseRecord(record);
+	}
+};
+
+static thread_local EpochRecordOwner epoch_record_owner;
+
+/**
+ * @brief Reuse an inactive record or push a new one onto the global list of records.
+ * Records are never freed, since other threads might be scanning them.
+ *
+ * @return EpochRecord*
+ */
+EpochRecord* EpochReclamation::AcquireRecord() {
+	for (EpochRecord* r = records.load(); r != nullptr; r = r->next) {
+		bool expected = false;
+		if (!r->active.load() && r->active.compare_exchange_strong(expected, true))
+			return r;
+	}
+	EpochRecord* r = new EpochRecord();
+	r->announced.store(0);
+	r->active.store(true);
+	r->nesting = 0;
+	r->retired_since_advance = 0;
+	for (uint32_t i = 0; i < EpochRecord::NUMBER_OF_BAGS; i++)
+		r->bag_epoch[i] = 0;
+	EpochRecord* head = records.load();
+	do {
+		r->next = head;
+	} while (!records.compare_exchange_weak(head, r));
+	return r;
+}
+
+/**
+ * @brief Return the record of the calling thread, acquiring one on first use.
+ *
+ * @return EpochRecord*
+ */
+EpochRecord* EpochReclamation::GetRecord() {
+	if (epoch_record_owner.record == nullptr)
+		epoch_record_owner.record = AcquireRecord();
+	return epoch_record_owner.record;
+}
+
+/**
+ * @brief Free what is already safe and mark the record as reusable. The remaining bags
+ * are taken over by the next owner.
+ *
+ * @param record
+ */
+void EpochReclamation::ReleaseRecord(EpochRecord* record) {
+	record->announced.store(0);
+	record->nesting = 0;
+	Collect(record);
+	record->active.store(false);
+}
+
+/**
+ * @brief Enter a critical section by announcing the current global epoch.
+ * Pointers read from shared memory afterwards stay valid until Exit().
+ */
+void EpochReclamation::Enter() {
+	EpochRecord* record = GetRecord();
+	if (record->nesting++ > 0)
+		return;
+	uint64_t epoch = global_epoch.load();
+	record->announced.store((epoch << 1) | 1);  // seq_cst, so no shared load is reordered before the announcement
+}
+
+/**
+ * @brief Leave a critical section.
+ */
+void EpochReclamation::Exit() {
+	EpochRecord* record = GetRecord();
+	if (--record->nesting > 0)
+		return;
+	record->announced.store(0, std::memory_order_release);
+}
+
+/**
+ * @brief Hand over an unlinked pointer. It gets freed with deleter two epochs later.
+ * Every ADVANCE_THRESHOLD retired pointers we try to advance the global epoch.
+ *
+ * @param pointer
+ * @param deleter
+ */
+void EpochReclamation::Retire(void* pointer, Deleter deleter) {
+	EpochRecord* record = GetRecord();
+	uint64_t epoch = global_epoch.load();
+	uint32_t bag = epoch % EpochRecord::NUMBER_OF_BAGS;
+	if (record->bag_epoch[bag] != epoch) {
+		Collect(record);
+		record->bag_epoch[bag] = epoch;
+	}
+	record->bags[bag].push_back({pointer, deleter});
+
+	if (++record->retired_since_advance >= ADVANCE_THRESHOLD) {
+		record->retired_since_advance = 0;
+		TryAdvance();
+		Collect(record);
+	}
+}
+
+/**
+ * @brief Advance the global epoch if every thread inside a critical section has
+ * already announced it.
+ *
+ * @return true if the epoch has been advanced (by us or someone else)
+ * @return false
+ */
+bool EpochReclamation::TryAdvance() {
+	uint64_t epoch = global_epoch.load();
+	for (EpochRecord* r = records.load(); r != nullptr; r = r->next) {
+		uint64_t announced = r->announced.load();
+		if ((announced & 1) && (announced >> 1) != epoch)
+			return false;
+	}
+	return global_epoch.compare_exchange_strong(epoch, epoch + 1) || epoch != global_epoch.load();
+}
+
+/**
+ * @brief Current global epoch. Once it is two ahead of an epoch read earlier, every thread that
+ * was inside a critical section at that point has left it.
+ *
+ * @return uint64_t
+ */
+uint64_t EpochReclamation::GetEpoch() {
+	return global_epoch.load();
+}
+
+/**
+ * @brief Free every bag of record that was filled at least two epochs ago.
+ *
+ * @param record
+ */
+void EpochReclamation::Collect(EpochRecord* record) {
+	uint64_t epoch = global_epoch.load();
+	for (uint32_t i = 0; i < EpochRecord::NUMBER_OF_BAGS; i++) {
+		if (record->bag_epoch[i] + 2 > epoch)
+			continue;
+		for (RetiredPointer retired : record->bags[i])
+			retired.deleter(retired.pointer);
+		record->bags[i].clear();
+	}
+}
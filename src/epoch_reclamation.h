@@ -0,0 +1,68 @@
+#ifndef EPOCH_RECLAMATION_H
+#define EPOCH_RECLAMATION_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include "hazard_pointers.h"
+
+struct alignas(64) EpochRecord {
+	static const uint32_t NUMBER_OF_BAGS = 3;
+	std::atomic<uint64_t> announced;  // (epoch << 1) | 1 while inside a critical section, 0 otherwise
+	std::atomic<bool> active;
+	EpochRecord* next;
+	uint32_t nesting;  // only touched by the thread owning the record
+	uint32_t retired_since_advance;
+	uint64_t bag_epoch[NUMBER_OF_BAGS];
+	std::vector<RetiredPointer> bags[NUMBER_OF_BAGS];  // pointers retired during bag_epoch[i]
+};
+
+/**
+ * Epoch based reclamation as in Fraser, Keir. "Practical lock-freedom." PhD thesis, University of Cambridge (2004).
+ * Threads announce the global epoch when they enter a critical section. The global epoch can
+ * only advance once every thread inside a critical section has announced the current epoch,
+ * so everything retired two epochs ago cannot be referenced anymore and gets freed.
+ * Readers pay one store on entry and one on exit, independent of how many nodes they visit.
+ */
+class EpochReclamation {
+   private:
+	static std::atomic<uint64_t> global_epoch;
+	static std::atomic<EpochRecord*> records;
+	static const uint32_t ADVANCE_THRESHOLD = 64;  // retired pointers between two attempts to advance the epoch
+	static EpochRecord* AcquireRecord();
+	static void Collect(EpochRecord* record);
+
+   public:
+	static EpochRecord* GetRecord();
+	static void ReleaseRecord(EpochRecord* record);
+	static void Enter();
+	static void Exit();
+	static void Retire(void* pointer, Deleter deleter);
+	static bool TryAdvance();
+	static uint64_t GetEpoch();
+};
+
+/**
+ * @brief Scoped critical section. Nested guards are cheap, only the outermost one announces.
+ * Disabled guards do nothing, so callers can pass whether EBR is the selected strategy.
+ */
+class EpochGuard {
+   private:
+	const bool enabled;
+
+   public:
+	explicit EpochGuard(bool enabled = true) : enabled(enabled) {
+		if (enabled)
+			EpochReclamation::Enter();
+	}
+	~EpochGuard() {
+		if (enabled)
+			EpochReclamation::Exit();
+	}
+	EpochGuard(const EpochGuard& epoch_guard) = delete;
+	EpochGuard& operator=(const EpochGuard& a) = delete;
+};
+
+#endif
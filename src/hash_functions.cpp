@@ -0,0 +1,82 @@
+/**
+ * @file hash_functions.cpp
+ * @author Josef Salzmann &	Aleksandar Hadzhiyski
+ * @brief Seeds and CRC32C for the hash functions of the hashtables.
+ * @date 2026-10-15
+ */
+#include "hash_functions.h"
+
+#include <nmmintrin.h>
+
+#include <random>
+
+/**
+ * @brief Lookup table of the reflected Castagnoli polynomial, for CPUs without SSE4.2.
+ */
+struct Crc32cTable {
+	uint32_t entries[256];
+
+	Crc32cTable() {
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t crc = i;
+			for (int bit = 0; bit < 8; bit++)
+				crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+			entries[i] = crc;
+		}
+	}
+};
+
+static const Crc32cTable crc32c_table;
+
+static bool HasSse42() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2");
+}
+
+static const bool has_sse42 = HasSse42();
+
+static uint32_t Crc32cSoftware(uint32_t crc, uint64_t value, int length) {
+	for (int i = 0; i < length; i++) {
+		crc = crc32c_table.entries[(crc ^ value) & 0xFF] ^ (crc >> 8);
+		value >>= 8;
+	}
+	return crc;
+}
+
+__attribute__((target("sse4.2"))) static uint32_t Crc32cHardware(uint32_t crc, uint32_t value) {
+	return _mm_crc32_u32(crc, value);
+}
+
+__attribute__((target("sse4.2"))) static uint32_t Crc32cHardware(uint32_t crc, uint64_t value) {
+	return (uint32_t)_mm_crc32_u64(crc, value);
+}
+
+/**
+ * @brief Fresh seed for a table, so every table hashes differently.
+ *
+ * @return uint64_t
+ */
+uint64_t RandomSeed() {
+	std::random_device random_device;
+	return ((uint64_t)random_device() << 32) | random_device();
+}
+
+/**
+ * @brief CRC32C of four bytes, without the usual final inversion. Both versions compute
+ * the same value, so a table hashes the same on every CPU.
+ *
+ * @param crc Initial value, we pass the seed.
+ * @param value
+ * @return uint32_t
+ */
+uint32_t Crc32c(uint32_t crc, uint32_t value) {
+	if (has_sse42)
+		return Crc32cHardware(crc, value);
+	return Crc32cSoftware(crc, value, 4);
+}
+
+uint32_t Crc32c(uint32_t crc, uint64_t value) {
+	if (has_sse42)
+		return Crc32cHardware(crc, value);
+	return Crc32cSoftware(crc, value, 8);
+}
@@ -0,0 +1,134 @@
+#ifndef HASH_FUNCTIONS_H
+#define HASH_FUNCTIONS_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+/**
+ * Hash functions a LockFreeHashTable can be built with. All of them take a per-table seed,
+ * so keys that happen to collide in one table do not collide in the next one.
+ * MIXER is the original integer mixer, CRC32C uses the SSE4.2 instruction if the CPU has it
+ * and an equivalent table driven version otherwise, WYHASH folds a 128 bit multiplication.
+ * CRC is affine in its initial value, so h(a) ^ h(b) would not depend on the seed and keys
+ * colliding in one table would collide in all of them. The CRC is therefore finished with a
+ * multiplication by the seed, which does not distribute over XOR.
+ */
+enum class HashKind {
+	MIXER,
+	CRC32C,
+	WYHASH
+};
+
+uint64_t RandomSeed();
+uint32_t Crc32c(uint32_t crc, uint32_t value);
+uint32_t Crc32c(uint32_t crc, uint64_t value);
+
+const uint64_t WY_P0 = 0xa0761d6478bd642f;
+const uint64_t WY_P1 = 0xe7037ed1a0b428db;
+
+/**
+ * @brief Multiply two words to 128 bits and fold the halves, the core of wyhash.
+ */
+inline uint64_t WyMix(uint64_t a, uint64_t b) {
+	__uint128_t product = (__uint128_t)a * b;
+	return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+inline uint64_t WyHash64(uint64_t value, uint64_t seed) {
+	return WyMix(value ^ seed ^ WY_P0, WyMix(value ^ WY_P1, seed ^ WY_P1));
+}
+
+/**
+ * @brief wyhash style hash of arbitrary bytes, consuming eight bytes per multiplication.
+ */
+inline uint64_t WyHashBytes(const void* data, size_t length, uint64_t seed) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t state = seed ^ WY_P0;
+	while (length >= 8) {
+		uint64_t word;
+		memcpy(&word, bytes, 8);
+		state = WyMix(word ^ WY_P1, state);
+		bytes += 8;
+		length -= 8;
+	}
+	uint64_t rest = 0;
+	memcpy(&rest, bytes, length);
+	return WyMix(rest ^ WY_P1 ^ length, state ^ WY_P0);
+}
+
+/**
+ * @brief Hash a 32 bit value with the given hash function and seed. The mixer is the basic
+ * one that seems to work out for our tables.
+ */
+inline uint32_t HashValue(HashKind hash_kind, uint64_t seed, uint32_t value) {
+	switch (hash_kind) {
+	case HashKind::CRC32C: {
+		uint64_t x = WyMix(Crc32c((uint32_t)seed, value) ^ WY_P0, seed ^ WY_P1);
+		return (uint32_t)(x ^ (x >> 32));
+	}
+	case HashKind::WYHASH:
+		return (uint32_t)WyHash64(value, seed);
+	case HashKind::MIXER:
+	default:
+		break;
+	}
+	uint32_t x = value ^ (uint32_t)seed;
+	x = ((x >> 16) ^ x) * 0x45d9f3b;
+	x = ((x >> 16) ^ x) * 0x45d9f3b;
+	x = (x >> 16) ^ x;
+	return x;
+}
+
+/**
+ * @brief Hash a 64 bit value with the given hash function and seed. The mixer is the splitmix64
+ * finalizer here, so the upper half gets filled as well. CRC32C only yields 32 bits, the
+ * multiplication finishing it takes the whole value, so all 64 bits matter.
+ */
+inline uint64_t HashValue(HashKind hash_kind, uint64_t seed, uint64_t value) {
+	switch (hash_kind) {
+	case HashKind::CRC32C: {
+		uint32_t crc = Crc32c((uint32_t)seed, value);
+		return WyMix(value ^ seed ^ WY_P0, crc ^ seed ^ WY_P1);
+	}
+	case HashKind::WYHASH:
+		return WyHash64(value, seed);
+	case HashKind::MIXER:
+	default:
+		break;
+	}
+	uint64_t x = value ^ seed;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+	x = x ^ (x >> 31);
+	return x;
+}
+
+/**
+ * Seeded hash functor for the keys of a LockFreeHashMap, meant for wide keys.
+ * Hashes the bytes of trivially copyable keys, so keys must not contain padding.
+ */
+template <typename K>
+struct WyHash {
+	uint64_t seed;
+
+	explicit WyHash(uint64_t seed = RandomSeed()) : seed(seed) {}
+
+	size_t operator()(const K& key) const {
+		return WyHashBytes(&key, sizeof(K), seed);
+	}
+};
+
+template <>
+struct WyHash<std::string> {
+	uint64_t seed;
+
+	explicit WyHash(uint64_t seed = RandomSeed()) : seed(seed) {}
+
+	size_t operator()(const std::string& key) const {
+		return WyHashBytes(key.data(), key.size(), seed);
+	}
+};
+
+#endif
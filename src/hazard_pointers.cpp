@@ -0,0 +1,139 @@
+/**
+ * @file hazard_pointers.cpp
+ * @author Josef Salzmann &	Aleksandar Hadzhiyski
+ * @brief Hazard pointer based memory reclamation. Every thread owns a record
+ * with a few hazard slots and a private list of retired pointers. Once the retired
+ * list grows beyond a threshold proportional to the total number of hazard slots
+ * we scan all records and free everything that is not protected, so the cost of a
+ * scan is amortized over many Retire() calls.
+ * @date 2026-10-15
+ */
+#include "hazard_pointers.h"
+
+std::atomic<HazardRecord*> HazardPointers::records(nullptr);
+std::atomic<uint32_t> HazardPointers::number_of_records(0);
+
+/**
+ * @brief Gives the record back to the global list once its thread terminates.
+ */
+struct HazardRecordOwner {
+	HazardRecord* record = nullptr;
+	~HazardRecordOwner() {
+		if (record != nullptr)
+			HazardPointers::ReleaseRecord(record);
+	}
+};
+
+static thread_local HazardRecordOwner record_owner;
+
+/**
+ * @brief Reuse an inactive record or push a new one onto the global list of records.
+ * Records are never freed, since other threads might be scanning them.
+ *
+ * @return HazardRecord*
+ */
+HazardRecord* HazardPointers::AcquireRecord() {
+	for (HazardRecord* r = records.load(); r != nullptr; r = r->next) {
+		bool expected = false;
+		if (!r->active.load() && r->active.compare_exchange_strong(expected, true))
+			return r;
+	}
+	HazardRecord* r = new HazardRecord();
+	for (uint32_t i = 0; i < HazardRecord::HAZARDS_PER_THREAD; i++)
+		r->hazards[i].store(nullptr);
+	r->active.store(true);
+	HazardRecord* head = records.load();
+	do {
+		r->next = head;
+	} while (!records.compare_exchange_weak(head, r));
+	number_of_records++;
+	return r;
+}
+
+/**
+ * @brief Return the record of the calling thread, acquiring one on first use.
+ *
+ * @return HazardRecord*
+ */
+HazardRecord* HazardPointers::GetRecord() {
+	if (record_owner.record == nullptr)
+		record_owner.record = AcquireRecord();
+	return record_owner.record;
+}
+
+/**
+ * @brief Clear all hazards of a record and mark it as reusable. Pointers that are still
+ * protected by other threads stay in the retired list and are taken over by the next owner.
+ *
+ * @param record
+ */
+void HazardPointers::ReleaseRecord(HazardRecord* record) {
+	for (uint32_t i = 0; i < HazardRecord::HAZARDS_PER_THREAD; i++)
+		record->hazards[i].store(nullptr);
+	Scan(record);
+	record->active.store(false);
+}
+
+/**
+ * @brief Publish a pointer in one of the hazard slots of the calling thread.
+ * The caller has to validate afterwards that the pointer is still reachable.
+ *
+ * @param slot
+ * @param pointer
+ */
+void HazardPointers::Protect(uint32_t slot, void* pointer) {
+	GetRecord()->hazards[slot].store(pointer);
+}
+
+/**
+ * @brief Drop all hazards of the calling thread.
+ */
+void HazardPointers::Clear() {
+	HazardRecord* record = GetRecord();
+	for (uint32_t i = 0; i < HazardRecord::HAZARDS_PER_THREAD; i++)
+		record->hazards[i].store(nullptr, std::memory_order_release);
+}
+
+/**
+ * @brief Hand over an unlinked pointer. It gets freed with deleter as soon as no hazard
+ * slot protects it anymore.
+ *
+ * @param pointer
+ * @param deleter
+ */
+void HazardPointers::Retire(void* pointer, Deleter deleter) {
+	HazardRecord* record = GetRecord();
+	record->retired.push_back({pointer, deleter});
+	uint32_t threshold = std::max(MIN_RETIRE_THRESHOLD, 2 * number_of_records.load(std::memory_order_relaxed) * HazardRecord::HAZARDS_PER_THREAD);
+	if (record->retired.size() >= threshold)
+		Scan(record);
+}
+
+/**
+ * @brief Collect all currently published hazards and free every retired pointer of record
+ * that is not among them.
+ *
+ * @param record
+ */
+void HazardPointers::Scan(HazardRecord* record) {
+	std::vector<void*> hazards;
+	hazards.reserve(number_of_records.load(std::memory_order_relaxed) * HazardRecord::HAZARDS_PER_THREAD);
+	for (HazardRecord* r = records.load(); r != nullptr; r = r->next) {
+		for (uint32_t i = 0; i < HazardRecord::HAZARDS_PER_THREAD; i++) {
+			void* hazard = r->hazards[i].load();
+			if (hazard != nullptr)
+				hazards.push_back(hazard);
+		}
+	}
+	std::sort(hazards.begin(), hazards.end());
+
+	size_t kept = 0;
+	for (size_t i = 0; i < record->retired.size(); i++) {
+		RetiredPointer retired = record->retired[i];
+		if (std::binary_search(hazards.begin(), hazards.end(), retired.pointer))
+			record->retired[kept++] = retired;
+		else
+			retired.deleter(retired.pointer);
+	}
+	record->retired.resize(kept);
+}
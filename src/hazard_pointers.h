@@ -0,0 +1,46 @@
+#ifndef HAZARD_POINTERS_H
+#define HAZARD_POINTERS_H
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+typedef void (*Deleter)(void*);
+
+struct RetiredPointer {
+	void* pointer;
+	Deleter deleter;
+};
+
+struct alignas(64) HazardRecord {
+	static const uint32_t HAZARDS_PER_THREAD = 4;
+	std::atomic<void*> hazards[HAZARDS_PER_THREAD];
+	std::atomic<bool> active;
+	HazardRecord* next;
+	std::vector<RetiredPointer> retired;  // only touched by the thread owning the record
+};
+
+/**
+ * Hazard pointers as in Michael, Maged M. "Hazard pointers: Safe memory reclamation for lock-free objects."
+ * IEEE Transactions on Parallel and Distributed Systems 15(6): 491-504 (2004).
+ * There is one global domain; every thread owns one record with HAZARDS_PER_THREAD slots.
+ */
+class HazardPointers {
+   private:
+	static std::atomic<HazardRecord*> records;
+	static std::atomic<uint32_t> number_of_records;
+	static const uint32_t MIN_RETIRE_THRESHOLD = 64;  // retired pointers we collect before the first scan
+	static HazardRecord* AcquireRecord();
+	static void Scan(HazardRecord* record);
+
+   public:
+	static HazardRecord* GetRecord();
+	static void ReleaseRecord(HazardRecord* record);
+	static void Protect(uint32_t slot, void* pointer);
+	static void Clear();
+	static void Retire(void* pointer, Deleter deleter);
+};
+
+#endif
@@ -27,6 +27,62 @@ bool LockBasedHashTable::Contains(ValueType value) {
 	return ret;
 }
 
+size_t LockBasedHashTable::Size() {
+	mutex.lock();
+	size_t ret = map.size();
+	mutex.unlock();
+	return ret;
+}
+
+void LockBasedHashTable::Reserve(size_t expected_size) {
+	mutex.lock();
+	map.reserve(expected_size);
+	mutex.unlock();
+}
+
+/*
+ * Read-modify-write operations with the same semantics as the ones of LockFreeHashMap,
+ * so the two can be compared. Here the map is used as an actual key/value map.
+ */
+
+bool LockBasedHashTable::PutIfAbsent(ValueType key, ValueType value, ValueType& existing) {
+	mutex.lock();
+	auto ret = map.insert({key, value});
+	if (!ret.second)
+		existing = ret.first->second;
+	mutex.unlock();
+	return ret.second;
+}
+
+bool LockBasedHashTable::Replace(ValueType key, ValueType expected, ValueType desired) {
+	mutex.lock();
+	auto it = map.find(key);
+	bool ret = it != map.end() && it->second == expected;
+	if (ret)
+		it->second = desired;
+	mutex.unlock();
+	return ret;
+}
+
+ValueType LockBasedHashTable::ComputeIfAbsent(ValueType key, const std::function<ValueType()>& factory) {
+	mutex.lock();
+	auto it = map.find(key);
+	if (it == map.end())
+		it = map.insert({key, factory()}).first;
+	ValueType ret = it->second;
+	mutex.unlock();
+	return ret;
+}
+
+ValueType LockBasedHashTable::FetchAdd(ValueType key, ValueType delta) {
+	mutex.lock();
+	ValueType& value = map[key];
+	ValueType ret = value;
+	value += delta;
+	mutex.unlock();
+	return ret;
+}
+
 std::string LockBasedHashTable::ToString() {
 	return "";  // we do not care
 }
\ No newline at end of file
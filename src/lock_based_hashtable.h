@@ -1,6 +1,7 @@
 #ifndef LOCK_BASED_HASHTABLE_H
 #define LOCK_BASED_HASHTABLE_H
 
+#include <functional>
 #include <mutex>
 #include <unordered_map>
 
@@ -17,6 +18,12 @@ class LockBasedHashTable : public HashTable {
 	bool Add(ValueType value) override;
 	bool Remove(ValueType value) override;
 	bool Contains(ValueType value) override;
+	size_t Size() override;
+	void Reserve(size_t expected_size) override;
+	bool PutIfAbsent(ValueType key, ValueType value, ValueType& existing);
+	bool Replace(ValueType key, ValueType expected, ValueType desired);
+	ValueType ComputeIfAbsent(ValueType key, const std::function<ValueType()>& factory);
+	ValueType FetchAdd(ValueType key, ValueType delta);
 	std::string ToString() override;
 };
 
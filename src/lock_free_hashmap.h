@@ -0,0 +1,445 @@
+#ifndef LOCK_FREE_HASHMAP_H
+#define LOCK_FREE_HASHMAP_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <type_traits>
+
+#include "bucket_directory.h"
+#include "epoch_reclamation.h"
+#include "split_order.h"
+#include "striped_counter.h"
+
+/**
+ * Concurrent key/value map on top of a split-ordered list, the same way LockFreeHashTable is
+ * built, but with arbitrary keys and values. Entries are ordered by the bit reversed hash of
+ * their key with the highest bit set, entries whose split-order keys collide are compared with Eq.
+ * Small trivially copyable values are stored inline in the entry, so a lookup costs one pointer
+ * chase, all other values are boxed behind a pointer.
+ * Sentinel nodes are never removed, the directory only grows. Removed entries and replaced value
+ * boxes are reclaimed with epochs.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class LockFreeHashMap {
+   private:
+	static const bool INLINE_VALUES = std::is_trivially_copyable<V>::value && sizeof(V) <= sizeof(uint64_t);
+	typedef typename std::conditional<INLINE_VALUES, V, V*>::type ValueWord;
+
+	struct MapNode {
+		const uint64_t so_key;  // split-order key, odd for entries and even for sentinel nodes
+		std::atomic<MapNode*> next;  // marked in the lowest bit once the entry is logically removed
+
+		explicit MapNode(uint64_t so_key) : so_key(so_key), next(nullptr) {}
+	};
+
+	struct EntryNode : MapNode {
+		const K key;
+		std::atomic<ValueWord> value;  // the value itself or a pointer to it
+
+		EntryNode(uint64_t so_key, const K& key, ValueWord value) : MapNode(so_key), key(key), value(value) {}
+	};
+
+	static const uint32_t MAX_AVERAGE_BUCKET_SIZE = 4;
+	static const uint32_t MAX_BUCKET_MASK = 0x7FFFFFFF;
+	static const uint64_t HIGH = 0x8000000000000000;
+	MapNode* head;  // sentinel node of bucket 0
+	BucketDirectory<MapNode> buckets;
+	StripedCounter map_size;
+	Hash hash;
+	Eq equal;
+
+	static MapNode* GetPointer(MapNode* node) {
+		return reinterpret_cast<MapNode*>(reinterpret_cast<uintptr_t>(node) & ~(uintptr_t)1);
+	}
+
+	static bool GetFlag(MapNode* node) {
+		return reinterpret_cast<uintptr_t>(node) & 1;
+	}
+
+	static MapNode* SetFlag(MapNode* node) {
+		return reinterpret_cast<MapNode*>(reinterpret_cast<uintptr_t>(node) | 1);
+	}
+
+	static ValueWord MakeWord(const V& value) {
+		if constexpr (INLINE_VALUES)
+			return value;
+		else
+			return new V(value);
+	}
+
+	static const V& ReadWord(const ValueWord& word) {
+		if constexpr (INLINE_VALUES)
+			return word;
+		else
+			return *word;
+	}
+
+	static void FreeWord(ValueWord word) {
+		if constexpr (!INLINE_VALUES)
+			delete word;
+	}
+
+	static void DeleteValue(void* value) {
+		delete static_cast<V*>(value);
+	}
+
+	static void DeleteEntry(void* node) {
+		EntryNode* entry = static_cast<EntryNode*>(node);
+		FreeWord(entry->value.load(std::memory_order_relaxed));
+		delete entry;
+	}
+
+	static uint64_t MakeEntryKey(uint64_t hash_value) {
+		return ReverseBits(hash_value | HIGH);
+	}
+
+	static uint64_t MakeSentinelKey(uint32_t bucket) {
+		return ReverseBits((uint64_t)bucket);
+	}
+
+	/**
+	 * @brief Find the window for a split-order key, unlinking and retiring marked entries on
+	 * the way. If key is nullptr we look for a sentinel node, otherwise for the entry with an equal key.
+	 * Has to be called inside a critical section.
+	 *
+	 * @param start Sentinel node to start from, sentinel nodes are never marked.
+	 * @param so_key
+	 * @param key
+	 * @param pred Last node before the searched one.
+	 * @param curr The searched node if found, otherwise the node before which it belongs.
+	 * @return true if the node was found
+	 */
+	bool Search(MapNode* start, uint64_t so_key, const K* key, MapNode** pred, MapNode** curr) {
+		while (true) {
+			bool restart = false;
+			MapNode* p = start;
+			MapNode* c = GetPointer(p->next.load());
+			while (c != nullptr) {
+				MapNode* succ = c->next.load();
+				if (GetFlag(succ)) {
+					MapNode* expected = c;
+					if (!p->next.compare_exchange_strong(expected, GetPointer(succ))) {
+						restart = true;
+						break;
+					}
+					EpochReclamation::Retire(c, DeleteEntry);
+					c = GetPointer(succ);
+					continue;
+				}
+				if (c->so_key > so_key)
+					break;
+				if (c->so_key == so_key && (key == nullptr || equal(static_cast<EntryNode*>(c)->key, *key))) {
+					*pred = p;
+					*curr = c;
+					return true;
+				}
+				p = c;
+				c = succ;
+			}
+			if (restart)
+				continue;
+			*pred = p;
+			*curr = c;
+			return false;
+		}
+	}
+
+	/**
+	 * @brief Return the sentinel node of a bucket, lazily inserting it (and the ones of its
+	 * parents) if the bucket has not been used so far.
+	 */
+	MapNode* GetBucket(uint32_t bucket) {
+		MapNode* sentinel = buckets.Load(bucket);
+		if (sentinel != nullptr)
+			return sentinel;
+		MapNode* start = GetBucket(GetParentBucket(bucket));
+		uint64_t so_key = MakeSentinelKey(bucket);
+		MapNode* node = new MapNode(so_key);
+		MapNode *pred, *curr;
+		while (true) {
+			if (Search(start, so_key, nullptr, &pred, &curr)) {
+				delete node;  // someone else was faster
+				node = curr;
+				break;
+			}
+			node->next.store(curr, std::memory_order_relaxed);
+			if (pred->next.compare_exchange_strong(curr, node))
+				break;
+		}
+		buckets.Store(bucket, node);
+		return node;
+	}
+
+	MapNode* GetStart(uint64_t hash_value) {
+		return GetBucket((uint32_t)hash_value & buckets.GetMask());
+	}
+
+	/**
+	 * @brief Walk to the unmarked entry of a key without modifying the list.
+	 * Has to be called inside a critical section.
+	 *
+	 * @param key
+	 * @return EntryNode* or nullptr if the key is not present
+	 */
+	EntryNode* Lookup(const K& key) {
+		uint64_t hash_value = hash(key);
+		uint64_t so_key = MakeEntryKey(hash_value);
+		MapNode* node = GetPointer(GetStart(hash_value)->next.load());
+		while (node != nullptr && node->so_key <= so_key) {
+			MapNode* next = node->next.load();
+			if (node->so_key == so_key && !GetFlag(next) && equal(static_cast<EntryNode*>(node)->key, key))
+				return static_cast<EntryNode*>(node);
+			node = GetPointer(next);
+		}
+		return nullptr;
+	}
+
+	/**
+	 * @brief Return the entry of a key, inserting a new one with the value made by factory
+	 * if the key is absent. Has to be called inside a critical section.
+	 * Doubles the directory once the average bucket holds more than MAX_AVERAGE_BUCKET_SIZE entries.
+	 *
+	 * @param key
+	 * @param factory Called at most once, when the first search did not find the key.
+	 * @param inserted Set to whether we inserted the entry.
+	 * @return EntryNode* the present or the inserted entry
+	 */
+	template <typename Factory>
+	EntryNode* InsertIfAbsent(const K& key, Factory factory, bool* inserted) {
+		uint64_t hash_value = hash(key);
+		uint64_t so_key = MakeEntryKey(hash_value);
+		MapNode* start = GetStart(hash_value);
+		EntryNode* node = nullptr;
+		MapNode *pred, *curr;
+		while (true) {
+			if (Search(start, so_key, &key, &pred, &curr)) {
+				if (node != nullptr)
+					DeleteEntry(node);  // never got published
+				*inserted = false;
+				return static_cast<EntryNode*>(curr);
+			}
+			if (node == nullptr)
+				node = new EntryNode(so_key, key, MakeWord(factory()));
+			node->next.store(curr, std::memory_order_relaxed);
+			if (pred->next.compare_exchange_strong(curr, node))
+				break;
+		}
+		map_size.Add(1);
+		uint32_t mask = buckets.GetMask();
+		if (map_size.GetApproximate() > (int64_t)MAX_AVERAGE_BUCKET_SIZE * (mask + 1) && mask < MAX_BUCKET_MASK)
+			buckets.Grow(mask);  // if the CAS fails someone else already doubled the directory
+		*inserted = true;
+		return node;
+	}
+
+   public:
+	/**
+	 * @brief Seeded hash functors like WyHash get a fresh seed per map unless one is passed in.
+	 */
+	explicit LockFreeHashMap(const Hash& hash = Hash(), const Eq& equal = Eq()) : buckets(2), hash(hash), equal(equal) {
+		head = new MapNode(0);
+		buckets.Store(0, head);
+	}
+
+	/**
+	 * @brief Free all nodes that are still linked. Only safe once no other thread accesses the map.
+	 */
+	~LockFreeHashMap() {
+		MapNode* node = head;
+		while (node != nullptr) {
+			MapNode* next = GetPointer(node->next.load(std::memory_order_relaxed));
+			if (node->so_key & 1)
+				DeleteEntry(node);
+			else
+				delete node;
+			node = next;
+		}
+	}
+
+	LockFreeHashMap(const LockFreeHashMap& lock_free_hashmap) = delete;
+	LockFreeHashMap& operator=(const LockFreeHashMap& a) = delete;
+
+	/**
+	 * @brief Insert a key with its value unless the key is already present.
+	 *
+	 * @param key
+	 * @param value
+	 * @return true if the entry was inserted
+	 */
+	bool Insert(const K& key, const V& value) {
+		EpochGuard guard;
+		bool inserted;
+		InsertIfAbsent(key, [&value]() { return value; }, &inserted);
+		return inserted;
+	}
+
+	/**
+	 * @brief Insert a key with its value unless the key is already present, in which case
+	 * the present value is copied out. Takes a single traversal, unlike Contains() plus Insert().
+	 *
+	 * @param key
+	 * @param value
+	 * @param existing Receives the present value if the key was already there.
+	 * @return true if the entry was inserted
+	 */
+	bool PutIfAbsent(const K& key, const V& value, V& existing) {
+		EpochGuard guard;
+		bool inserted;
+		EntryNode* entry = InsertIfAbsent(key, [&value]() { return value; }, &inserted);
+		if (!inserted)
+			existing = ReadWord(entry->value.load());
+		return inserted;
+	}
+
+	/**
+	 * @brief Return the value of a key, inserting the one made by factory if the key is absent.
+	 * The factory is called at most once and only if the key was absent when we looked, if another
+	 * thread inserts the key in the meantime its value wins and ours is dropped.
+	 *
+	 * @param key
+	 * @param factory Callable without arguments returning a V.
+	 * @return V the present or the inserted value
+	 */
+	template <typename Factory>
+	V ComputeIfAbsent(const K& key, Factory factory) {
+		EpochGuard guard;
+		bool inserted;
+		EntryNode* entry = InsertIfAbsent(key, factory, &inserted);
+		return ReadWord(entry->value.load());
+	}
+
+	/**
+	 * @brief Replace the value of a key with desired if it currently is expected, with one CAS on
+	 * the value word. Boxed values are compared with operator==, the replaced box is retired.
+	 * A replace that races with an erase of the same entry takes effect on the removed entry,
+	 * which is fine since nobody can observe it after the erase.
+	 *
+	 * @param key
+	 * @param expected
+	 * @param desired
+	 * @return true if the value was replaced
+	 */
+	bool Replace(const K& key, const V& expected, const V& desired) {
+		EpochGuard guard;
+		EntryNode* entry = Lookup(key);
+		if (entry == nullptr)
+			return false;
+		if constexpr (INLINE_VALUES) {
+			V current = expected;
+			return entry->value.compare_exchange_strong(current, desired);
+		} else {
+			V* box = nullptr;
+			V* current = entry->value.load();
+			while (*current == expected) {
+				if (box == nullptr)
+					box = new V(desired);
+				if (entry->value.compare_exchange_weak(current, box)) {
+					EpochReclamation::Retire(current, DeleteValue);
+					return true;
+				}
+			}
+			delete box;
+			return false;
+		}
+	}
+
+	/**
+	 * @brief Atomically add delta to the value of a key and return the previous value.
+	 * An absent key is inserted with delta as if it had been there with the value V().
+	 * Only available for arithmetic values. Those wider than a word, e.g. long double, are boxed,
+	 * then every addition swaps in a new box and retires the old one.
+	 *
+	 * @param key
+	 * @param delta
+	 * @return V the value before the addition
+	 */
+	V FetchAdd(const K& key, V delta) {
+		static_assert(std::is_arithmetic<V>::value, "FetchAdd needs arithmetic values");
+		EpochGuard guard;
+		bool inserted;
+		EntryNode* entry = InsertIfAbsent(key, [delta]() { return delta; }, &inserted);
+		if (inserted)
+			return V();
+		if constexpr (!INLINE_VALUES) {
+			V* box = new V();
+			V* current = entry->value.load();
+			do {
+				*box = *current + delta;
+			} while (!entry->value.compare_exchange_weak(current, box));
+			V previous = *current;
+			EpochReclamation::Retire(current, DeleteValue);
+			return previous;
+		} else if constexpr (std::is_integral<V>::value) {
+			return entry->value.fetch_add(delta);
+		} else {
+			V current = entry->value.load();
+			while (!entry->value.compare_exchange_weak(current, current + delta)) {
+			}
+			return current;
+		}
+	}
+
+	/**
+	 * @brief Look up a key and copy its value out.
+	 *
+	 * @param key
+	 * @param value Receives the value if the key is present.
+	 * @return true if the key is present
+	 */
+	bool Find(const K& key, V& value) {
+		EpochGuard guard;
+		EntryNode* entry = Lookup(key);
+		if (entry == nullptr)
+			return false;
+		value = ReadWord(entry->value.load());
+		return true;
+	}
+
+	bool Contains(const K& key) {
+		EpochGuard guard;
+		return Lookup(key) != nullptr;
+	}
+
+	/**
+	 * @brief Remove a key. The entry is marked first, so concurrent inserts cannot link behind it,
+	 * and unlinked afterwards, either by us or by the next traversal passing by.
+	 *
+	 * @param key
+	 * @return true if we removed the key
+	 */
+	bool Erase(const K& key) {
+		EpochGuard guard;
+		uint64_t hash_value = hash(key);
+		uint64_t so_key = MakeEntryKey(hash_value);
+		MapNode* start = GetStart(hash_value);
+		MapNode *pred, *curr;
+		while (true) {
+			if (!Search(start, so_key, &key, &pred, &curr))
+				return false;
+			MapNode* succ = curr->next.load();
+			if (GetFlag(succ))
+				continue;
+			if (!curr->next.compare_exchange_strong(succ, SetFlag(succ)))
+				continue;
+			MapNode* expected = curr;
+			if (pred->next.compare_exchange_strong(expected, succ))
+				EpochReclamation::Retire(curr, DeleteEntry);
+			else
+				Search(start, so_key, &key, &pred, &curr);  // unlinks the marked entry
+			map_size.Add(-1);
+			return true;
+		}
+	}
+
+	/**
+	 * @brief Number of entries, exact as long as no Insert() or Erase() runs concurrently.
+	 */
+	size_t Size() {
+		int64_t size = map_size.GetExact();
+		return size < 0 ? 0 : (size_t)size;
+	}
+};
+
+#endif
@@ -3,226 +3,221 @@
  * @author Josef Salzmann &	Aleksandar Hadzhiyski
  * @brief Implement a lock free hashtable based on
  * Ori Shalev, Nir Shavit: Split-ordered lists: Lock-free extensible hash tables. J. ACM 53(3): 379-405 (2006)
+ * The algorithm lives in SplitOrderedHashTable, this maps the runtime options onto its policies.
  * @date 2022-05-30
  */
 
 #include "lock_free_hashtable.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 /**
  * @brief Construct a new Lock Free Hash Table:: Lock Free Hash Table object
- * Initializing the underlying list yields one head node  with value 0
- * and one tail node with value UINT32_MAX. We just need to add another sentinel node
- * with value 1, so that we have two sentinel nodes in total. The tail node of the list
- * will be never accessed.
+ * backed by the SplitOrderedHashTable with the Reclaimer policy of the given reclamation scheme.
+ *
+ * @param reclamation How nodes removed from the underlying list are freed.
+ * @param hash_kind Hash function used for the values.
+ * @param seed Seed of the hash function, random unless given.
  */
-LockFreeHashTable::LockFreeHashTable() {
-	list = new LockFreeList();
-	std::vector<TableEntry>* hashtable_init = new std::vector<TableEntry>(2);
-	hashtable = new std::vector<TableEntry>();
-	TableEntry first_htable_element = {};
-	first_htable_element.sentinel_node = list->GetHead();
-	(*hashtable_init)[0] = first_htable_element;
-	TableEntry second_htable_element = {};
-	KeyType second_sentinel_node_key = MakeSentinelKey(1);
-	NodeType* second_sentinel_ptr = list->AddAndGetPointer(list->GetHead(), {second_sentinel_node_key, 1});
-	second_htable_element.sentinel_node = second_sentinel_ptr;
-	(*hashtable_init)[1] = second_htable_element;
-
-	hashtable.store(hashtable_init, std::memory_order_seq_cst);
-
-	table_size.store(0);
+LockFreeHashTable::LockFreeHashTable(Reclamation reclamation, HashKind hash_kind, uint64_t seed) : reclamation(reclamation) {
+	RuntimeHash hash(hash_kind, seed);
+	switch (reclamation) {
+	case Reclamation::NONE:
+		adapter = new HashTableAdapter<Table<NoReclaimer>>(hash);
+		break;
+	case Reclamation::EPOCH:
+		adapter = new HashTableAdapter<Table<EpochReclaimer>>(hash);
+		break;
+	case Reclamation::HAZARD_POINTERS:
+	default:
+		adapter = new HashTableAdapter<Table<HazardPointerReclaimer>>(hash);
+		break;
+	}
 }
 
 /**
- * @brief Return the unmarked pointer to the hashtable.
+ * @brief Construct a table that is ready for expected_size elements, see Reserve().
  *
- * @return std::vector<TableEntry>*
+ * @param expected_size
+ * @param reclamation How nodes removed from the underlying list are freed.
+ * @param hash_kind Hash function used for the values.
+ * @param seed Seed of the hash function, random unless given.
  */
-std::vector<TableEntry>* LockFreeHashTable::GetHashtablePointer() {
-	return static_cast<std::vector<TableEntry>*>(list->GetPointer(hashtable.load(std::memory_order_seq_cst)));
+LockFreeHashTable::LockFreeHashTable(size_t expected_size, Reclamation reclamation, HashKind hash_kind, uint64_t seed) : LockFreeHashTable(reclamation, hash_kind, seed) {
+	Reserve(expected_size);
 }
 
 /**
- * @brief Basic hashfunction which seems to work out.
- * @param value the value that should be hashed.
- *
- * @return The hashed value.
+ * @brief Only safe once no other thread accesses the table.
  */
-KeyType LockFreeHashTable::HashFunction(ValueType value) {
-	uint32_t x = value;
-	x = ((x >> 16) ^ x) * 0x45d9f3b;
-	x = ((x >> 16) ^ x) * 0x45d9f3b;
-	x = (x >> 16) ^ x;
-	return x;
+LockFreeHashTable::~LockFreeHashTable() {
+	delete adapter;
 }
 
-/**
- * @brief Gets the number of bits we are currently using for our sentinel nodes,
- * which is basically log2 of the number of sentinel nodes.
- *
- * @return uint32_t
- */
-uint32_t LockFreeHashTable::GetNumberOfBitsUsed() {
-	std::vector<TableEntry>* htable_ptr = GetHashtablePointer();
-	uint32_t hashtable_size = (*htable_ptr).size();
-	return (uint32_t)log2(hashtable_size);
+bool LockFreeHashTable::Add(ValueType value) {
+	return Dispatch([&](auto* table) { return table->Add(value); });
 }
 
-/**
- * @brief Return the sentinel node a given value.
- *
- * @param value The value for which we want the sentinel node aka start node
- * @return NodeType*
- */
-NodeType* LockFreeHashTable::GetSentinelNode(ValueType value) {
-	uint32_t value_lower_bits = (uint32_t)value & (ALLONE >> (32 - GetNumberOfBitsUsed()));
-	std::vector<TableEntry>* htable_ptr = GetHashtablePointer();
-	return (*htable_ptr)[value_lower_bits].sentinel_node;
+bool LockFreeHashTable::Remove(ValueType value) {
+	return Dispatch([&](auto* table) { return table->Remove(value); });
 }
 
-/**
- * @brief Add an element to the hashtable.
- * If the tablesize is bigger MAX_AVERAGE_BUCKET_SIZE * size(hashtable) we double the size of the table.
- *
- *
- * @param value Value to be added to the hashtable.
- * @return true
- * @return false
- */
-bool LockFreeHashTable::Add(ValueType value) {
-	NodeType* sentinel = GetSentinelNode(HashFunction(value));
-	KeyType key = MakeNormalKey(value);
-	bool success = list->Add(sentinel, {key, value});
-	if (!success) {
-		return false;
-	} else {
-		table_size++;  // actual table size and "table_size" are not updated atomically,
-		    // but that should not be a problem since the resize regime is not that strict.
-		std::vector<TableEntry>* htable_old = GetHashtablePointer();
-		uint32_t permissibletablesize = MAX_AVERAGE_BUCKET_SIZE * (*htable_old).size();
-		if ((uint32_t)table_size > permissibletablesize && !list->GetFlag(htable_old)) {
-			std::vector<TableEntry>* marked_htable = htable_old;
-			list->SetFlag((void**)&marked_htable);
-			if (hashtable.compare_exchange_strong(htable_old, marked_htable)) {  // we set the mark of the hashtable pointer to
-				                                                                 // 1 to indicate that we are about to double the table.
-				                                                                 // So no two threads try to double the table at the same time.
-				DoubleHashTableSize();
-			}
-		}
+bool LockFreeHashTable::Contains(ValueType value) {
+	return Dispatch([&](auto* table) { return table->Contains(value); });
+}
 
-		return true;
-	}
+void LockFreeHashTable::ContainsBatch(const ValueType* values, size_t count, uint64_t* results) {
+	Dispatch([&](auto* table) { table->ContainsBatch(values, count, results); });
+}
+
+void LockFreeHashTable::AddBatch(const ValueType* values, size_t count, uint64_t* results) {
+	Dispatch([&](auto* table) { table->AddBatch(values, count, results); });
+}
+
+void LockFreeHashTable::RemoveBatch(const ValueType* values, size_t count, uint64_t* results) {
+	Dispatch([&](auto* table) { table->RemoveBatch(values, count, results); });
 }
 
 /**
- * @brief Check if a value is contained in the hashtable.
+ * @brief See SplitOrderedHashTable::BulkBuild().
  *
- * @param value Value for which we check.
- * @return true
- * @return false
+ * @param values
+ * @param count
+ * @param n_threads
+ * @return size_t Number of distinct values that got added.
  */
-bool LockFreeHashTable::Contains(ValueType value) {
-	NodeType* sentinel = GetSentinelNode(HashFunction(value));
-	KeyType key = MakeNormalKey(value);
-	return list->Contains(sentinel, {key, value});
+size_t LockFreeHashTable::BulkBuild(const ValueType* values, size_t count, int n_threads) {
+	return Dispatch([&](auto* table) { return table->BulkBuild(values, count, n_threads); });
 }
 
 /**
- * @brief Add a sentinel node. Called while doubleing the table.
+ * @brief See SplitOrderedHashTable::Reserve().
  *
- * @param value Value of the sentinel node.
- * @return NodeType* a pointer to the sentinel node.
+ * @param expected_size
+ * @param n_threads Threads inserting sentinel nodes, 0 for the OpenMP default.
  */
-NodeType* LockFreeHashTable::AddSentinelNode(ValueType value) {
-	NodeType* start = GetSentinelNode(value & ~(1 << GetNumberOfBitsUsed()));  // set MSB to zero
-	KeyType key = MakeSentinelKey(value);
-	auto ret = list->AddAndGetPointer(start, {key, value});
-	return ret;
+void LockFreeHashTable::Reserve(size_t expected_size, int n_threads) {
+	Dispatch([&](auto* table) { table->Reserve(expected_size, n_threads); });
 }
 
-/**
- * @brief Double the hashtable by creating a new vector of table elements, copying the current
- * sentinel nodes and adding new ones. This is basically the main difference of our implementation
- * and the one presented in the paper. In the paper the sentinel nodes get initialized only when the 
- * are needed.
- */
-void LockFreeHashTable::DoubleHashTableSize() {
-	std::vector<TableEntry>* htable_ptr = GetHashtablePointer();
-	uint32_t current_max_entry = (*htable_ptr).size();
-	std::vector<TableEntry>* htable_new = new std::vector<TableEntry>(current_max_entry * 2);
-	for (uint32_t i = 0; i < current_max_entry; i++) {
-		(*htable_new)[i] = (*htable_ptr)[i];
-	}
-	for (uint32_t i = current_max_entry; i < current_max_entry * 2; i++) {
-		NodeType* newSentinel = AddSentinelNode(i);
-		(*htable_new)[i].sentinel_node = newSentinel;
-	}
-	hashtable.store(htable_new, std::memory_order_seq_cst);
+void LockFreeHashTable::Reserve(size_t expected_size) {
+	Reserve(expected_size, 0);
+}
+
+size_t LockFreeHashTable::Size() {
+	return Dispatch([&](auto* table) { return table->Size(); });
+}
+
+void LockFreeHashTable::ForEach(const std::function<void(ValueType)>& function) {
+	Dispatch([&](auto* table) { table->ForEach(function); });
+}
+
+void LockFreeHashTable::ParallelForEach(const std::function<void(ValueType)>& function, int n_threads) {
+	Dispatch([&](auto* table) { table->ParallelForEach(function, n_threads); });
+}
+
+void LockFreeHashTable::ForEachInRange(uint32_t range, uint32_t number_of_ranges, const std::function<void(ValueType)>& function) {
+	Dispatch([&](auto* table) { table->ForEachInRange(range, number_of_ranges, function); });
+}
+
+uint32_t LockFreeHashTable::GetNumberOfBuckets() {
+	return Dispatch([&](auto* table) { return table->GetNumberOfBuckets(); });
+}
+
+bool LockFreeHashTable::SaveSnapshot(const std::string& path) {
+	return Dispatch([&](auto* table) { return table->SaveSnapshot(path); });
 }
 
 /**
- * @brief Remove an element from the hashtable.
+ * @brief Create a table from a file written by SaveSnapshot(), with the hash function and seed
+ * of the saved table. The file is mapped and the list rebuilt in one pass over it, see
+ * LinkSnapshot(). Files that do not fit this build or are truncated are rejected, the keys
+ * themselves are trusted as long as they are in list order.
  *
- * @param value The value to be removed.
- * @return true
- * @return false
+ * @param path
+ * @param reclamation How nodes removed from the underlying list are freed.
+ * @return LockFreeHashTable* nullptr if the file could not be loaded
  */
-bool LockFreeHashTable::Remove(ValueType value) {
-	NodeType* sentinel = GetSentinelNode(HashFunction(value));
-	KeyType key = MakeNormalKey(value);
-	bool success = list->Remove(sentinel, {key, value});
-	if (!success) {
-		return false;
-	} else {
-		table_size--;  // actual table size and "table_size" are not updated atomically, but that should not be a problem since the resize regime is not that strict.
-		return true;
+LockFreeHashTable* LockFreeHashTable::LoadSnapshot(const std::string& path, Reclamation reclamation) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+	struct stat file_stat;
+	void* data = MAP_FAILED;
+	if (fstat(fd, &file_stat) == 0 && (size_t)file_stat.st_size >= sizeof(SnapshotHeader))
+		data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return nullptr;
+	madvise(data, file_stat.st_size, MADV_SEQUENTIAL);
+
+	const SnapshotHeader* header = static_cast<const SnapshotHeader*>(data);
+	size_t max_count = ((size_t)file_stat.st_size - sizeof(SnapshotHeader)) / sizeof(KeyValue);
+	LockFreeHashTable* table = nullptr;
+	if (header->magic == SNAPSHOT_MAGIC && header->key_size == sizeof(KeyType) && header->item_size == sizeof(KeyValue) &&
+	    header->hash_kind <= (uint32_t)HashKind::WYHASH && header->count <= max_count &&
+	    sizeof(SnapshotHeader) + header->count * sizeof(KeyValue) == (size_t)file_stat.st_size) {
+		table = new LockFreeHashTable(reclamation, (HashKind)header->hash_kind, header->seed);
+		const KeyValue* items = reinterpret_cast<const KeyValue*>(header + 1);
+		if (!table->Dispatch([&](auto* split_table) { return split_table->LinkSnapshot(items, header->count, header->mask); })) {
+			delete table;
+			table = nullptr;
+		}
 	}
+	munmap(data, file_stat.st_size);
+	return table;
 }
 
-/**
- * @brief Make a normal key for a normal (i.e. not sentinel) value.
- * The key is basically the reversed masked hash with its LSB set to one.
- * This ensures that we are always bigger than the respective sentinel node.
- *
- * @param value The value for which we want to make a key.
- * @return KeyType
- */
-KeyType LockFreeHashTable::MakeNormalKey(ValueType value) {
-	KeyType key = HashFunction(value) & MASK;
-	return Reverse(key | HIGH);
+HashKind LockFreeHashTable::GetHashKind() {
+	return Dispatch([&](auto* table) { return table->GetHashKind(); });
+}
+
+uint64_t LockFreeHashTable::GetSeed() {
+	return Dispatch([&](auto* table) { return table->GetSeed(); });
 }
 
 /**
- * @brief Make a sentinel key. The lowest bit of the key is never set.
+ * @brief Change how the list handles failed CAS, before the table gets used.
  *
- * @param value
- * @return KeyType
+ * @param contention
  */
-KeyType LockFreeHashTable::MakeSentinelKey(ValueType value) {
-	return Reverse(value & MASK);
+void LockFreeHashTable::SetContentionManagement(ContentionManagement contention) {
+	Dispatch([&](auto* table) { table->SetContentionManagement(contention); });
+}
+
+size_t LockFreeHashTable::GetMemoryUsage() {
+	return Dispatch([&](auto* table) { return table->GetMemoryUsage(); });
+}
+
+std::string LockFreeHashTable::ToString() {
+	return adapter->ToString();
 }
 
 /**
- * @brief Method to reverse the bit orderd of an input value.
+ * @brief Iterate over the buckets the table has right now, the ranges stay valid if it resizes.
  *
- * @param input The value to be reversed.
- * @return KeyType
+ * @param table
  */
-KeyType LockFreeHashTable::Reverse(uint32_t input) {
-	uint32_t no_bits = sizeof(input) * 8;
-	uint32_t reverse_num = 0;
-	for (uint32_t i = 0; i < no_bits; i++) {
-		if ((input & (1 << i)))
-			reverse_num |= 1 << ((no_bits - 1) - i);
-	}
-	return reverse_num;
-}
+LockFreeHashTableIterator::LockFreeHashTableIterator(LockFreeHashTable* table) : table(table), number_of_ranges(table->GetNumberOfBuckets()), next_range(0), position(0) {}
 
 /**
- * @brief Return the string of the list for some debugging.
+ * @brief Return the next element, visiting the next range once the buffered ones are used up.
  *
- * @return std::string
+ * @param value Receives the element.
+ * @return true
+ * @return false if the iteration is done
  */
-std::string LockFreeHashTable::ToString() {
-	return list->ToString();
-}
\ No newline at end of file
+bool LockFreeHashTableIterator::Next(ValueType* value) {
+	while (position == buffer.size()) {
+		if (next_range == number_of_ranges)
+			return false;
+		buffer.clear();
+		position = 0;
+		table->ForEachInRange(next_range++, number_of_ranges, [this](ValueType element) { buffer.push_back(element); });
+	}
+	*value = buffer[position++];
+	return true;
+}
@@ -1,22 +1,17 @@
 #ifndef LOCK_FREE_HASHTABLE_H
 #define LOCK_FREE_HASHTABLE_H
 
-#include <math.h>
 #include <stdint.h>
-#include <stdio.h>
 #include <string.h>
 
-#include <atomic>
+#include <functional>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "hash_functions.h"
 #include "lock_free_list.h"
-
-typedef uint32_t ValueType;
-typedef uint32_t KeyType;
-
-struct TableEntry {
-	NodeType* sentinel_node;
-};
+#include "split_ordered_hashtable.h"
 
 class HashTable {
    public:
@@ -24,37 +19,174 @@ class HashTable {
 	virtual bool Add(ValueType value) = 0;
 	virtual bool Remove(ValueType value) = 0;
 	virtual bool Contains(ValueType value) = 0;
+	virtual size_t Size() = 0;
 	virtual std::string ToString() = 0;
+
+	/*
+	 * Prepare the table for the given number of elements, so it does not have to resize while
+	 * filling up. Only a hint, by default it does nothing.
+	 */
+	virtual void Reserve(size_t expected_size) {}
+
+	/*
+	 * Batched versions of Contains(), Add() and Remove(). Bit i of the bitmap results, which has
+	 * to hold (count + 63) / 64 words, is set if the operation on values[i] returned true.
+	 * Tables that can overlap the cache misses of independent values override them,
+	 * by default we just loop.
+	 */
+	virtual void ContainsBatch(const ValueType* values, size_t count, uint64_t* results) {
+		memset(results, 0, (count + 63) / 64 * sizeof(uint64_t));
+		for (size_t i = 0; i < count; i++)
+			results[i / 64] |= (uint64_t)Contains(values[i]) << (i % 64);
+	}
+
+	virtual void AddBatch(const ValueType* values, size_t count, uint64_t* results) {
+		memset(results, 0, (count + 63) / 64 * sizeof(uint64_t));
+		for (size_t i = 0; i < count; i++)
+			results[i / 64] |= (uint64_t)Add(values[i]) << (i % 64);
+	}
+
+	virtual void RemoveBatch(const ValueType* values, size_t count, uint64_t* results) {
+		memset(results, 0, (count + 63) / 64 * sizeof(uint64_t));
+		for (size_t i = 0; i < count; i++)
+			results[i / 64] |= (uint64_t)Remove(values[i]) << (i % 64);
+	}
+};
+
+/**
+ * Thin HashTable around a table with the same non-virtual operations, for code that picks its
+ * table at runtime. Callers that know the type call GetTable() to skip the virtual calls.
+ */
+template <typename Table>
+class HashTableAdapter : public HashTable {
+   private:
+	Table table;
+
+   public:
+	template <typename... Args>
+	explicit HashTableAdapter(Args&&... args) : table(std::forward<Args>(args)...) {}
+
+	bool Add(ValueType value) override {
+		return table.Add(value);
+	}
+
+	bool Remove(ValueType value) override {
+		return table.Remove(value);
+	}
+
+	bool Contains(ValueType value) override {
+		return table.Contains(value);
+	}
+
+	size_t Size() override {
+		return table.Size();
+	}
+
+	std::string ToString() override {
+		return table.ToString();
+	}
+
+	void Reserve(size_t expected_size) override {
+		table.Reserve(expected_size);
+	}
+
+	void ContainsBatch(const ValueType* values, size_t count, uint64_t* results) override {
+		table.ContainsBatch(values, count, results);
+	}
+
+	void AddBatch(const ValueType* values, size_t count, uint64_t* results) override {
+		table.AddBatch(values, count, results);
+	}
+
+	void RemoveBatch(const ValueType* values, size_t count, uint64_t* results) override {
+		table.RemoveBatch(values, count, results);
+	}
+
+	Table& GetTable() {
+		return table;
+	}
 };
 
+/**
+ * SplitOrderedHashTable with the hash function and the reclamation scheme picked at runtime.
+ * The reclamation scheme selects one of the Reclaimer policies, the table behind it is a
+ * HashTableAdapter of that instantiation and every operation is forwarded through Dispatch(),
+ * a single switch before the inlined operation of the template.
+ */
 class LockFreeHashTable : public HashTable {
    private:
-	LockFreeList* list;
-	std::atomic<std::vector<TableEntry>*> hashtable;
-	const uint32_t MAX_AVERAGE_BUCKET_SIZE = 4;  // if table_size > MAX_AVERAGE_BUCKET_SIZE * size(hashtable) then we double the number of hashtable entries
-	const uint32_t HIGH = 0x80000000;
-	const uint32_t MASK = 0x00FFFFFF;
-	const uint32_t ALLONE = 0xFFFFFFFF;
-	std::atomic<uint32_t> table_size;  // number of elements in the table without sentinel nodes
-	KeyType HashFunction(ValueType value);
-	KeyType MakeNormalKey(ValueType value);
-	KeyType MakeSentinelKey(KeyType key);
-	KeyType Reverse(KeyType input);
-	void DoubleTableSize();
-	NodeType* GetSentinelNode(ValueType item);
-	uint32_t GetNumberOfBitsUsed();
-	NodeType* AddSentinelNode(ValueType value);
-	std::vector<TableEntry>* GetHashtablePointer();
-	void DoubleHashTableSize();
+	template <typename Reclaimer>
+	using Table = SplitOrderedHashTable<RuntimeHash, Reclaimer>;
+	const Reclamation reclamation;  // sentinel nodes and directory segments are reclaimed with epochs unless it is NONE
+	HashTable* adapter;  // HashTableAdapter of the Table matching reclamation
+	void ForEachInRange(uint32_t range, uint32_t number_of_ranges, const std::function<void(ValueType)>& function);
+	uint32_t GetNumberOfBuckets();
+	friend class LockFreeHashTableIterator;
 
    public:
-	LockFreeHashTable();
-	LockFreeHashTable(const LockFreeHashTable& lock_free_hashtable);
+	explicit LockFreeHashTable(Reclamation reclamation = Reclamation::HAZARD_POINTERS, HashKind hash_kind = HashKind::MIXER, uint64_t seed = RandomSeed());
+	explicit LockFreeHashTable(size_t expected_size, Reclamation reclamation = Reclamation::HAZARD_POINTERS, HashKind hash_kind = HashKind::MIXER, uint64_t seed = RandomSeed());
+	LockFreeHashTable(const LockFreeHashTable& lock_free_hashtable) = delete;
+	~LockFreeHashTable() override;
 	bool Add(ValueType value) override;
 	bool Remove(ValueType value) override;
 	bool Contains(ValueType value) override;
+	void ContainsBatch(const ValueType* values, size_t count, uint64_t* results) override;
+	void AddBatch(const ValueType* values, size_t count, uint64_t* results) override;
+	void RemoveBatch(const ValueType* values, size_t count, uint64_t* results) override;
+	size_t BulkBuild(const ValueType* values, size_t count, int n_threads);
+	void Reserve(size_t expected_size) override;
+	void Reserve(size_t expected_size, int n_threads);
+	size_t Size() override;
+	void ForEach(const std::function<void(ValueType)>& function);
+	void ParallelForEach(const std::function<void(ValueType)>& function, int n_threads);
+	bool SaveSnapshot(const std::string& path);
+	static LockFreeHashTable* LoadSnapshot(const std::string& path, Reclamation reclamation = Reclamation::HAZARD_POINTERS);
+	HashKind GetHashKind();
+	void SetContentionManagement(ContentionManagement contention);
+	uint64_t GetSeed();
+	size_t GetMemoryUsage();
 	std::string ToString() override;
-	LockFreeHashTable& operator=(const LockFreeHashTable& a);  // make cppcheck happy
+	LockFreeHashTable& operator=(const LockFreeHashTable& a) = delete;
+
+	/**
+	 * @brief Call function with the SplitOrderedHashTable behind this table, cast to its actual
+	 * type, so callers that do a lot of operations instantiate them for it and skip the virtual calls.
+	 *
+	 * @param function Called with a pointer to the table, its result is returned.
+	 */
+	template <typename Function>
+	auto Dispatch(Function function) {
+		switch (reclamation) {
+		case Reclamation::NONE:
+			return function(&static_cast<HashTableAdapter<Table<NoReclaimer>>*>(adapter)->GetTable());
+		case Reclamation::EPOCH:
+			return function(&static_cast<HashTableAdapter<Table<EpochReclaimer>>*>(adapter)->GetTable());
+		case Reclamation::HAZARD_POINTERS:
+		default:
+			return function(&static_cast<HashTableAdapter<Table<HazardPointerReclaimer>>*>(adapter)->GetTable());
+		}
+	}
+};
+
+/**
+ * Weakly consistent iterator over a LockFreeHashTable, for scans that must not stop the writers.
+ * It visits the list one bucket range at a time and buffers the values of the current range, so
+ * it holds no hazards or epochs between two calls of Next(). Elements that stay in the table
+ * during the whole iteration are returned exactly once, concurrently added or removed ones
+ * may or may not be.
+ */
+class LockFreeHashTableIterator {
+   private:
+	LockFreeHashTable* table;
+	const uint32_t number_of_ranges;
+	uint32_t next_range;
+	std::vector<ValueType> buffer;  // values of the current range
+	size_t position;
+
+   public:
+	explicit LockFreeHashTableIterator(LockFreeHashTable* table);
+	bool Next(ValueType* value);
 };
 
 #endif
@@ -4,12 +4,25 @@
 #include <stdint.h>
 
 #include <atomic>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <string>
 
+#include "backoff.h"
+#include "epoch_reclamation.h"
+#include "hazard_pointers.h"
+
+// Building with -DSPLIT_ORDER_KEYS_64 switches to 64 bit split-order keys and values,
+// which lifts the limit of 2^24 buckets the 32 bit keys impose on the hashtable.
+#ifdef SPLIT_ORDER_KEYS_64
+typedef uint64_t KeyType;
+typedef uint64_t ValueType;
+#else
 typedef uint32_t KeyType;
 typedef uint32_t ValueType;
+#endif
 
 struct KeyValue {
 	KeyType key;
@@ -42,46 +55,623 @@ struct KeyValue {
 	}
 };
 
+/**
+ * The mark of a node lives in the lowest bit of next, so a node is just key, value and pointer.
+ * With 32 bit keys that is 16 bytes and the cache line aligned slabs of the NodePool hold four
+ * nodes per cache line, none of them split across two lines. With 64 bit keys it is 24 bytes,
+ * padding those to 32 would cost a third more memory for the same nodes.
+ */
+#ifdef SPLIT_ORDER_KEYS_64
 struct NodeType {
+#else
+struct alignas(16) NodeType {
+#endif
 	KeyValue item;
-	bool mark;
 	std::atomic<NodeType*> next;
 };
 
+#ifdef SPLIT_ORDER_KEYS_64
+static_assert(sizeof(NodeType) == 24, "nodes with 64 bit keys should not be padded");
+#else
+static_assert(sizeof(NodeType) == 16, "four nodes should fit into a cache line");
+#endif
+
 struct Window {
 	NodeType* pred;
 	NodeType* curr;
 };
 
+/**
+ * How unlinked nodes are freed. NONE leaks them, which is what the list did originally
+ * and is kept as a baseline for the benchmarks.
+ */
+enum class Reclamation {
+	NONE,
+	HAZARD_POINTERS,
+	EPOCH
+};
+
+/**
+ * What the list does after a failed CAS. Backing off gives the winner time to finish instead of
+ * hitting the same cache line again right away, resuming from the predecessor of the failed CAS
+ * saves walking the chain from the start node once more.
+ */
+struct ContentionManagement {
+	uint32_t min_backoff;  // pause instructions after the first failed CAS, 0 retries right away
+	uint32_t max_backoff;  // further failures double the pauses up to this bound
+	bool resume_from_pred;  // retry from the predecessor if it is still unmarked, instead of from the start node
+};
+
+const ContentionManagement NO_CONTENTION_MANAGEMENT = {0, 0, false};
+const ContentionManagement DEFAULT_CONTENTION_MANAGEMENT = {4, 1024, true};
+
+/**
+ * Reclaimer policies of LockFreeList and SplitOrderedHashTable, matching the Reclamation options.
+ * Unlinked data nodes go to Retire(). PROTECTS says whether traversals have to publish and
+ * validate the nodes they visit, which only hazard pointers need. RECLAIMS says whether unlinked
+ * sentinel nodes and directory segments get freed, the hashtable does that with epochs and holds
+ * a Guard, a critical section, around every operation unless nothing gets reclaimed at all.
+ */
+struct NoReclaimer {
+	static const bool PROTECTS = false;
+	static const bool RECLAIMS = false;
+
+	struct Guard {
+		Guard() {}
+	};
+
+	static void Retire(void* pointer, Deleter deleter) {}
+};
+
+struct EpochReclaimer {
+	static const bool PROTECTS = false;
+	static const bool RECLAIMS = true;
+	typedef EpochGuard Guard;
+
+	static void Retire(void* pointer, Deleter deleter) {
+		EpochReclamation::Retire(pointer, deleter);
+	}
+};
+
+struct HazardPointerReclaimer {
+	static const bool PROTECTS = true;
+	static const bool RECLAIMS = true;
+	typedef EpochGuard Guard;  // covers sentinel nodes and directory segments, the list protects the data nodes
+
+	static void Retire(void* pointer, Deleter deleter) {
+		HazardPointers::Retire(pointer, deleter);
+	}
+};
+
+inline thread_local uint64_t list_thread_retries = 0;  // failed CAS of the calling thread, over all lists
+
+/**
+ * @brief Number of failed CAS the calling thread retried so far, in all lists.
+ *
+ * @return uint64_t
+ */
+inline uint64_t GetListThreadRetries() {
+	return list_thread_retries;
+}
+
+/**
+ * Lock free list as presented in the slides.
+ * With the addition of a "start" node from which the Find() method will start.
+ * The "start" node will of course be the respective sentinel node of an entry.
+ * Also the method AddAndGetPointer() has been added to add sentinel nodes
+ * and return pointers to them.
+ * How unlinked nodes are freed and where nodes come from are given by the Reclaimer and
+ * Allocator policies, so the list inlines into the hashtable without branching on them.
+ * Sentinel nodes are unlinked by the hashtable only, which takes care of freeing them.
+ */
+template <typename Reclaimer, typename Allocator>
 class LockFreeList {
    private:
 	std::atomic<NodeType*> head;
-	Window Find(NodeType* start, KeyValue item);
+	ContentionManagement contention;
+	static const uint32_t HP_PRED = 0;  // hazard slots used by FindProtected()
+	static const uint32_t HP_CURR = 1;
+	static const uint32_t HP_SUCC = 2;
+	static const uint32_t HP_START = 3;  // node a retry resumes from
+
+	/**
+	 * @brief Drop the hazards of the calling thread at the end of an operation.
+	 */
+	static void ClearHazards() {
+		if constexpr (Reclaimer::PROTECTS)
+			HazardPointers::Clear();
+	}
+
+	/**
+	 * @brief Find method from the slides only that the starting node is a sentinel
+	 * node supplied by the hashtable. Marked nodes on the way are unlinked and retired
+	 * by the thread whose CAS succeeds, if that CAS fails we back off and start over,
+	 * from pred if it is still unmarked.
+	 *
+	 * @param start The sentinel node of the operation.
+	 * @param from The node to walk from, start or the node a retry of the caller resumes at.
+	 * @param item
+	 * @return Window
+	 */
+	Window Find(NodeType* start, NodeType* from, KeyValue item) {
+		if constexpr (Reclaimer::PROTECTS)
+			return FindProtected(start, from, item);
+
+		Backoff backoff(contention.min_backoff, contention.max_backoff);
+		// Search for item or successor
+		while (true) {
+			NodeType* pred = GetStart(start, from);
+			NodeType* curr = static_cast<NodeType*>(GetPointer(pred->next));
+			bool restart = false;
+
+			while (!restart) {
+				if (curr->next == nullptr) {  // we are at the end of the list
+					return {pred, curr};
+				}
+				NodeType* succ = curr->next;
+				if (GetFlag(succ)) {
+					// curr is logically deleted, try to unlink it
+					ResetFlag((void**)&succ);
+					NodeType* expected = curr;
+					if (!pred->next.compare_exchange_strong(expected, succ)) {
+						list_thread_retries++;
+						backoff.Pause();
+						from = GetResumeNode(start, pred);
+						restart = true;
+						continue;
+					}
+					RetireNode(curr);
+					curr = succ;
+					continue;
+				}
+				if (curr->item >= item) {
+					return {pred, curr};
+				}
+				pred = curr;
+				curr = succ;
+			}
+		}
+	}
+
+	/**
+	 * @brief Find() with hazard pointers, following Michael's SMR paper. pred, curr and succ
+	 * are protected in the slots HP_PRED, HP_CURR and HP_SUCC. After protecting a node we
+	 * validate that it is still reachable, otherwise it might already have been freed and we start over,
+	 * from pred if it is still unmarked. pred is protected all along, so it can move over into HP_START.
+	 * The returned window stays protected until the caller clears its hazards.
+	 *
+	 * @param start The sentinel node of the operation.
+	 * @param from start or a node protected by HP_START.
+	 * @param item
+	 * @return Window
+	 */
+	Window FindProtected(NodeType* start, NodeType* from, KeyValue item) {
+		HazardRecord* record = HazardPointers::GetRecord();
+		Backoff backoff(contention.min_backoff, contention.max_backoff);
+
+		while (true) {
+			NodeType* pred = GetStart(start, from);  // sentinel nodes are covered by the epoch of the hashtable, other nodes by HP_START
+			NodeType* curr = static_cast<NodeType*>(GetPointer(pred->next));
+			record->hazards[HP_CURR].store(curr);
+			if (pred->next != curr)
+				continue;
+
+			while (true) {
+				if (curr->next == nullptr) {  // we are at the end of the list
+					return {pred, curr};
+				}
+				NodeType* succ = curr->next;
+				NodeType* unmarked_succ = static_cast<NodeType*>(GetPointer(succ));
+				record->hazards[HP_SUCC].store(unmarked_succ);
+				if (curr->next != succ || pred->next != curr) {
+					from = GetResumeNode(start, pred);
+					break;  // the window changed, succ might already be retired
+				}
+
+				if (GetFlag(succ)) {
+					// curr is logically deleted, try to unlink it
+					NodeType* expected = curr;
+					if (!pred->next.compare_exchange_strong(expected, unmarked_succ)) {
+						list_thread_retries++;
+						backoff.Pause();
+						from = GetResumeNode(start, pred);
+						break;
+					}
+					RetireNode(curr);
+					curr = unmarked_succ;
+					record->hazards[HP_CURR].store(curr);  // still covered by HP_SUCC
+					continue;
+				}
+				if (curr->item >= item) {
+					return {pred, curr};
+				}
+				pred = curr;
+				record->hazards[HP_PRED].store(pred);  // still covered by HP_CURR
+				curr = unmarked_succ;
+				record->hazards[HP_CURR].store(curr);  // still covered by HP_SUCC
+			}
+		}
+	}
+
+	/**
+	 * @brief Common part of Add() and AddAndGetPointer().
+	 * The node is taken from the Allocator, if the item already exists it goes straight back,
+	 * with the NodePool it will be handed out again by the next Add() of this thread.
+	 *
+	 * @param start
+	 * @param item
+	 * @param inserted Set to whether the item has been inserted by us, may be nullptr.
+	 * @return NodeType* the node holding item
+	 */
+	NodeType* Insert(NodeType* start, KeyValue item, bool* inserted) {
+		Window w;
+
+		NodeType* n = Allocator::Allocate();
+		n->item = item;
+		n->next = nullptr;
+		Backoff backoff(contention.min_backoff, contention.max_backoff);
+		NodeType* from = start;
+
+		while (true) {
+			w = Find(start, from, item);
+			NodeType* pred = w.pred;
+			NodeType* curr = w.curr;
+
+			if (curr != nullptr && curr->item == item) {
+				Allocator::Free(n);
+				ClearHazards();
+				if (inserted != nullptr)
+					*inserted = false;
+				return curr;
+			}
+
+			n->next = curr;
+
+			// unmark new node
+			ResetFlag((void**)&n->next);
+			ResetFlag((void**)&curr);
+
+			if (pred->next.compare_exchange_strong(curr, n)) {
+				ClearHazards();
+				if (inserted != nullptr)
+					*inserted = true;
+				return n;
+			}
+			list_thread_retries++;
+			backoff.Pause();
+			from = GetResumeNode(start, pred);
+		}
+	}
+
+	/**
+	 * @brief Node a retry after a failed CAS at pred starts from. If pred is still unmarked it is
+	 * still linked and comes before the item, so we can go on from there instead of from start.
+	 * With hazard pointers pred is protected by the caller and moves over into HP_START.
+	 *
+	 * @param start The node the operation started from.
+	 * @param pred
+	 * @return NodeType*
+	 */
+	NodeType* GetResumeNode(NodeType* start, NodeType* pred) {
+		NodeType* node = start;
+		if (contention.resume_from_pred && !GetFlag(pred->next))
+			node = pred;
+		if constexpr (Reclaimer::PROTECTS)
+			HazardPointers::Protect(HP_START, node);
+		return node;
+	}
+
+	/**
+	 * @brief Hand an unlinked node over to the reclamation scheme. Sentinel nodes (even keys)
+	 * are only removed when the hashtable shrinks, which retires them itself.
+	 *
+	 * @param node
+	 */
+	static void RetireNode(NodeType* node) {
+		if ((node->item.key & 0x1) == 0)
+			return;
+		Reclaimer::Retire(node, &Allocator::Delete);
+	}
 
    public:
-	LockFreeList() : head(new NodeType()) {
-		NodeType* tail_imm = new NodeType();
-		tail_imm->item.key = UINT32_MAX;
-		tail_imm->item.value = UINT32_MAX;  // HashFunction(UINT32_MAX) < UINT32_MAX, so we know that no element comes after this one
-		tail_imm->mark = false;
+	/**
+	 * @brief Construct a new list consisting of a head node with key 0 and a tail node with the largest key.
+	 */
+	LockFreeList() : head(nullptr), contention(DEFAULT_CONTENTION_MANAGEMENT) {
+		NodeType* tail_imm = Allocator::Allocate();
+		tail_imm->item.key = std::numeric_limits<KeyType>::max();
+		tail_imm->item.value = std::numeric_limits<ValueType>::max();  // the largest value does not hash to the largest key, so we know that no element comes after this one
 		tail_imm->next.store(nullptr);
-		NodeType* head_imm = new NodeType();
+		NodeType* head_imm = Allocator::Allocate();
 		head_imm->item.key = 0;
 		head_imm->item.value = 0;
-		head_imm->mark = false;
 		head_imm->next.store(tail_imm);
 		head.store(head_imm);
-	};
-	bool Contains(NodeType* start, KeyValue item);
-	bool Add(NodeType* start, KeyValue item);
-	NodeType* AddAndGetPointer(NodeType* start, KeyValue item);
-	bool Remove(NodeType* start, KeyValue item);
-	NodeType* GetHead();
-	void* GetPointer(void* markedpointer);
-	bool GetFlag(void* markedpointer);
-	void SetFlag(void** markedpointer);
-	void ResetFlag(void** markedpointer);
-	std::string ToString();
+	}
+
+	/**
+	 * @brief Free all nodes that are still linked. Nodes that have already been retired
+	 * are owned by the reclamation scheme.
+	 */
+	~LockFreeList() {
+		NodeType* current_node = head;
+		while (current_node != nullptr) {
+			NodeType* next_node = static_cast<NodeType*>(GetPointer(current_node->next));
+			Allocator::Free(current_node);
+			current_node = next_node;
+		}
+	}
+
+	LockFreeList(const LockFreeList& lock_free_list) = delete;
+	LockFreeList& operator=(const LockFreeList& a) = delete;
+
+	/**
+	 * @brief Contains method as from the slides, only that the starting node is a sentinel
+	 * node supplied by the hashtable. With hazard pointers we cannot walk over nodes that
+	 * might already be freed, so we take the protected Find() instead. Otherwise the
+	 * unprotected walk is fine as long as the caller is inside a critical section.
+	 *
+	 * @param start
+	 * @param item
+	 * @return true
+	 * @return false
+	 */
+	bool Contains(NodeType* start, KeyValue item) {
+		if constexpr (Reclaimer::PROTECTS) {
+			Window w = FindProtected(start, start, item);
+			bool found = w.curr->item == item;
+			HazardPointers::Clear();
+			return found;
+		}
+		// same as lazy implementation
+		// except marked flag is part of next pointer
+		NodeType* n = GetStart(start, start);
+		while (n != nullptr && n->item < item) {
+			n = static_cast<NodeType*>(GetPointer(n->next));
+		}
+		if (n == nullptr)
+			return false;
+		return n->item == item && !GetFlag(n->next);
+	}
+
+	/**
+	 * @brief Add method from the slides only that the starting node is a sentinel
+	 * node supplied by the hashtable
+	 *
+	 * @param start
+	 * @param item
+	 * @return true
+	 * @return false
+	 */
+	bool Add(NodeType* start, KeyValue item) {
+		bool inserted;
+		Insert(start, item, &inserted);
+		return inserted;
+	}
+
+	/**
+	 * @brief Basically the same method ass Add(), only that we return a pointer
+	 * into the list to the element with the given item, no matter whether we inserted
+	 * it or it already existed. Used for adding sentinel nodes, which stay valid as long as
+	 * the caller is inside the critical section of the hashtable.
+	 *
+	 * @param start
+	 * @param item
+	 * @return NodeType*
+	 */
+	NodeType* AddAndGetPointer(NodeType* start, KeyValue item) {
+		return Insert(start, item, nullptr);
+	}
+
+	/**
+	 * @brief Remove method from the slides only that the starting node is a sentinel
+	 * node supplied by the hashtable. Whoever unlinks the node retires it. If our attempt fails
+	 * we snip it with Find() like Harris does, so the node is unlinked once we return.
+	 *
+	 * @param start
+	 * @param item
+	 * @return true
+	 * @return false
+	 */
+	bool Remove(NodeType* start, KeyValue item) {
+		Window w;
+		Backoff backoff(contention.min_backoff, contention.max_backoff);
+		NodeType* from = start;
+
+		while (true) {
+			w = Find(start, from, item);
+			if (w.curr == nullptr || item != w.curr->item) {
+				ClearHazards();
+				return false;
+			}
+
+			NodeType* succ = w.curr->next;
+			NodeType* markedsucc = succ;
+			// mark as deleted
+			SetFlag((void**)&markedsucc);
+			ResetFlag((void**)&succ);
+			if (!w.curr->next.compare_exchange_strong(succ, markedsucc)) {
+				list_thread_retries++;
+				backoff.Pause();
+				from = GetResumeNode(start, w.pred);
+				continue;
+			}
+			// attempt to unlink curr
+			NodeType* curr = w.curr;
+			if (w.pred->next.compare_exchange_strong(curr, succ))
+				RetireNode(w.curr);
+			else
+				Find(start, GetResumeNode(start, w.pred), item);
+			ClearHazards();
+			return true;
+		}
+	}
+
+	/**
+	 * @brief Call function with the value of every data node whose key lies in [begin_key, end_key),
+	 * walking from start. Weakly consistent: elements that are in the
+	 * list during the whole walk are visited exactly once, concurrently added or removed ones may or
+	 * may not be. With hazard pointers every step is validated like in FindProtected(), which also
+	 * means unlinking marked nodes on the way. If the window changed we start over and skip the
+	 * elements we already visited, which is fine since the list is sorted.
+	 * function must not call into the list, it runs while we hold our hazards.
+	 *
+	 * @param start A node before begin_key, usually a sentinel node.
+	 * @param begin_key
+	 * @param end_key 0 walks to the end of the list.
+	 * @param function
+	 */
+	void ForEach(NodeType* start, KeyType begin_key, KeyType end_key, const std::function<void(ValueType)>& function) {
+		const bool protect = Reclaimer::PROTECTS;
+		HazardRecord* record = protect ? HazardPointers::GetRecord() : nullptr;
+		bool visited_any = false;
+		KeyValue last_visited = {0, 0};
+
+		while (true) {
+			NodeType* pred = GetStart(start, start);
+			NodeType* curr = static_cast<NodeType*>(GetPointer(pred->next));
+			if (protect) {
+				record->hazards[HP_CURR].store(curr);
+				if (pred->next != curr)
+					continue;
+			}
+			bool restart = false;
+			while (curr->next != nullptr) {  // the tail node is not an element
+				if (end_key != 0 && curr->item.key >= end_key)
+					break;
+				NodeType* succ = curr->next;
+				if (protect) {
+					record->hazards[HP_SUCC].store(GetPointer(succ));
+					if (curr->next != succ || pred->next != curr) {
+						restart = true;
+						break;
+					}
+				}
+				if (GetFlag(succ)) {
+					if (protect) {
+						// we cannot step over curr with a validated window, so unlink it like Find() does
+						NodeType* unmarked_succ = static_cast<NodeType*>(GetPointer(succ));
+						NodeType* expected = curr;
+						if (!pred->next.compare_exchange_strong(expected, unmarked_succ)) {
+							restart = true;
+							break;
+						}
+						RetireNode(curr);
+						curr = unmarked_succ;
+						record->hazards[HP_CURR].store(curr);  // still covered by HP_SUCC
+						continue;
+					}
+				} else if ((curr->item.key & 0x1) && curr->item.key >= begin_key && (!visited_any || last_visited < curr->item)) {
+					function(curr->item.value);
+					visited_any = true;
+					last_visited = curr->item;
+				}
+				pred = curr;
+				curr = static_cast<NodeType*>(GetPointer(succ));
+				if (protect) {
+					record->hazards[HP_PRED].store(pred);  // still covered by HP_CURR
+					record->hazards[HP_CURR].store(curr);  // still covered by HP_SUCC
+				}
+			}
+			if (!restart)
+				break;
+		}
+		ClearHazards();
+	}
+
+	/**
+	 * @brief Return the head element of the list.
+	 * Needed for the initializiation of the hashtable.
+	 *
+	 * @return NodeType*
+	 */
+	NodeType* GetHead() {
+		return head;
+	}
+
+	/**
+	 * @brief The node a traversal begins with. Usually this is from, the sentinel node start or
+	 * the node a retry resumes at. If from got marked in the meantime we go back to start, and if
+	 * the hashtable shrank and unlinked start as well we have to fall back to the head of the list.
+	 * That only happens to operations that loaded their sentinel node right before it was
+	 * removed, so the long walk is rare.
+	 *
+	 * @param start The sentinel node of the operation, the hashtable keeps it from being freed.
+	 * @param from start or the node a retry resumes at, protected by HP_START with hazard pointers.
+	 * @return NodeType*
+	 */
+	NodeType* GetStart(NodeType* start, NodeType* from) {
+		if (!GetFlag(from->next))
+			return from;
+		if (from != start && !GetFlag(start->next))
+			return start;
+		return head.load();
+	}
+
+	/**
+	 * @brief For marked pointers we use the LSB of the pointer as a mark.
+	 *
+	 * @param markedpointer
+	 * @return void*
+	 */
+	static void* GetPointer(void* markedpointer) {
+		return (void*)(((uintptr_t)markedpointer) & ~1);
+	}
+
+	static bool GetFlag(void* markedpointer) {
+		return ((uintptr_t)markedpointer) & 1;
+	}
+
+	static void SetFlag(void** markedpointer) {
+		(*markedpointer) = (void*)((uintptr_t)(*markedpointer) | 1);
+	}
+
+	static void ResetFlag(void** markedpointer) {
+		(*markedpointer) = (void*)((uintptr_t)(*markedpointer) & ~1);
+	}
+
+	/**
+	 * @brief Change how failed CAS are handled. Not meant to be called while other threads use the list.
+	 *
+	 * @param contention
+	 */
+	void SetContentionManagement(ContentionManagement contention) {
+		this->contention = contention;
+	}
+
+	/**
+	 * @brief Count the nodes that are linked, sentinel nodes, head and tail included.
+	 * Only meant for statistics while no other thread modifies the list.
+	 *
+	 * @return size_t
+	 */
+	size_t GetNumberOfNodes() {
+		size_t count = 0;
+		NodeType* current_node = head;
+		while (current_node != nullptr) {
+			count++;
+			current_node = static_cast<NodeType*>(GetPointer(current_node->next));
+		}
+		return count;
+	}
+
+	std::string ToString() {
+		NodeType* current_node = head;
+		std::stringstream ss;
+		int count = 0;
+		while (current_node != nullptr) {
+			ss << "Node " << count << ": ";
+			if ((current_node->item.key & 0x1) == 0)
+				ss << "Sentinel-Node ";
+			ss << "Key " << current_node->item.key
+			   << ", Value " << current_node->item.value
+			   << ", Mark " << GetFlag(current_node->next) << "\n";
+			count++;
+			current_node = static_cast<NodeType*>(GetPointer(current_node->next));
+		}
+
+		return ss.str();
+	}
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -3,16 +3,27 @@
 #include <omp.h>
 #include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <ctime>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <random>
 #include <string>
 
+#include "batch_kernels.h"
+#include "cuckoo_hashtable.h"
 #include "lock_based_hashtable.h"
+#include "lock_free_hashmap.h"
 #include "lock_free_hashtable.h"
+#include "node_pool.h"
+#include "open_addressing_hashtable.h"
+#include "split_order.h"
+#include "split_ordered_hashtable.h"
+#include "striped_hashtable.h"
+#include "unrolled_hashtable.h"
 
 #define FIXED_DOUBLE(x) std::fixed << std::setprecision(2) << (x)
 
@@ -26,9 +37,173 @@ void Usage(const std::string& prog_name) {
 	          << "-r	Record and save speedup in a file (default: false)" << std::endl
 	          << "-g	Test throughput with one global region instead of thread local regions (default: false)" << std::endl
 	          << "-v	Test throughput with variyng load factor" << std::endl
+	          << "-u	Test throughput of FetchAdd() on shared counters of the key/value maps" << std::endl
+	          << "-b	Test throughput of ContainsBatch() with batches of the given size" << std::endl
+	          << "-l	Additionally time BulkBuild() against parallel Add() calls" << std::endl
+	          << "-p	Reserve the hashtables for the given number of elements before each test (default: 0)" << std::endl
+	          << "-m	Memory reclamation of the lock-free hashtable: none, hp, epoch (default: hp)" << std::endl
+	          << "-f	Hash function of the lock-free hashtable: mixer, crc32c, wyhash (default: mixer)" << std::endl
+	          << "-e	Engine of the lock-free hashtable: split, unrolled, cuckoo, template, open (default: split)" << std::endl
+	          << "-o	Lock-based hashtable to compare against: global, striped, seqlock (default: global)" << std::endl
+	          << "-x	Contention management of the split-ordered list: none, backoff, resume, all (default: all)" << std::endl
 	          << "-h	Print this message" << std::endl;
 }
 
+std::string ReclamationName(Reclamation reclamation) {
+	switch (reclamation) {
+	case Reclamation::NONE:
+		return "none";
+	case Reclamation::HAZARD_POINTERS:
+		return "hazard pointers";
+	case Reclamation::EPOCH:
+		return "epochs";
+	}
+	return "";
+}
+
+std::string HashKindName(HashKind hash_kind) {
+	switch (hash_kind) {
+	case HashKind::MIXER:
+		return "mixer";
+	case HashKind::CRC32C:
+		return "crc32c";
+	case HashKind::WYHASH:
+		return "wyhash";
+	}
+	return "";
+}
+
+template <HashKind KIND, typename Reclaimer>
+using TemplateEngine = HashTableAdapter<SplitOrderedHashTable<SeededHash<KIND>, Reclaimer>>;
+
+template <typename Reclaimer>
+HashTable* MakeTemplateEngine(HashKind hash_kind) {
+	switch (hash_kind) {
+	case HashKind::CRC32C:
+		return new TemplateEngine<HashKind::CRC32C, Reclaimer>();
+	case HashKind::WYHASH:
+		return new TemplateEngine<HashKind::WYHASH, Reclaimer>();
+	case HashKind::MIXER:
+	default:
+		return new TemplateEngine<HashKind::MIXER, Reclaimer>();
+	}
+}
+
+/**
+ * @brief Instantiate SplitOrderedHashTable with the policies matching the runtime options.
+ *
+ * @param reclamation
+ * @param hash_kind
+ * @return HashTable*
+ */
+HashTable* MakeTemplateEngine(Reclamation reclamation, HashKind hash_kind) {
+	switch (reclamation) {
+	case Reclamation::NONE:
+		return MakeTemplateEngine<NoReclaimer>(hash_kind);
+	case Reclamation::EPOCH:
+		return MakeTemplateEngine<EpochReclaimer>(hash_kind);
+	case Reclamation::HAZARD_POINTERS:
+	default:
+		return MakeTemplateEngine<HazardPointerReclaimer>(hash_kind);
+	}
+}
+
+/**
+ * Lock-free hashtable implementations the benchmark can run against the lock-based one.
+ * Correctness tests run all of them.
+ */
+struct Engine {
+	std::string name;
+	std::string description;
+	std::function<HashTable*(Reclamation, HashKind)> make;
+};
+
+const std::vector<Engine> ENGINES = {
+    {"split", "split-ordered list", [](Reclamation reclamation, HashKind hash_kind) -> HashTable* { return new LockFreeHashTable(reclamation, hash_kind); }},
+    {"unrolled", "unrolled split-ordered list, always epochs", [](Reclamation reclamation, HashKind hash_kind) -> HashTable* { return new UnrolledHashTable(hash_kind); }},
+    {"cuckoo", "bucketized cuckoo hashing, optimistic reads and bucket locks for writers", [](Reclamation reclamation, HashKind hash_kind) -> HashTable* { return new CuckooHashTable(hash_kind); }},
+    {"template", "split-ordered list with the hash function fixed at compile time", [](Reclamation reclamation, HashKind hash_kind) -> HashTable* { return MakeTemplateEngine(reclamation, hash_kind); }},
+#ifndef SPLIT_ORDER_KEYS_64
+    {"open", "open addressing with linear probing, always epochs", [](Reclamation reclamation, HashKind hash_kind) -> HashTable* { return new OpenAddressingHashTable(hash_kind); }},
+#endif
+};
+
+const Engine* FindEngine(const std::string& name) {
+	for (const Engine& engine : ENGINES) {
+		if (engine.name == name)
+			return &engine;
+	}
+	return nullptr;
+}
+
+/**
+ * Lock-based hashtables the lock-free engine can be compared against.
+ * Correctness tests run all of them.
+ */
+struct Baseline {
+	std::string name;
+	std::string description;
+	std::function<HashTable*(HashKind)> make;
+};
+
+const std::vector<Baseline> BASELINES = {
+    {"global", "std::unordered_map behind one mutex", [](HashKind hash_kind) -> HashTable* { return new LockBasedHashTable(); }},
+    {"striped", "lock striping with open addressing", [](HashKind hash_kind) -> HashTable* { return new StripedHashTable(StripedReads::LOCKED, hash_kind); }},
+    {"seqlock", "lock striping with open addressing and seqlock reads", [](HashKind hash_kind) -> HashTable* { return new StripedHashTable(StripedReads::SEQLOCK, hash_kind); }},
+};
+
+const Baseline* FindBaseline(const std::string& name) {
+	for (const Baseline& baseline : BASELINES) {
+		if (baseline.name == name)
+			return &baseline;
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Call function with a baseline cast to its actual type, for the tests of the
+ * read-modify-write operations, which are not part of HashTable.
+ *
+ * @param baseline
+ * @param function
+ */
+template <typename Function>
+void WithBaselineType(HashTable* baseline, Function function) {
+	if (StripedHashTable* myStripedHashTable = dynamic_cast<StripedHashTable*>(baseline))
+		function(myStripedHashTable);
+	else
+		function(static_cast<LockBasedHashTable*>(baseline));
+}
+
+template <typename Reclaimer, typename Function>
+bool WithTemplateEngineType(HashTable* engine, Function function) {
+	if (auto* myTemplateEngine = dynamic_cast<TemplateEngine<HashKind::MIXER, Reclaimer>*>(engine))
+		function(&myTemplateEngine->GetTable());
+	else if (auto* myTemplateEngine = dynamic_cast<TemplateEngine<HashKind::CRC32C, Reclaimer>*>(engine))
+		function(&myTemplateEngine->GetTable());
+	else if (auto* myTemplateEngine = dynamic_cast<TemplateEngine<HashKind::WYHASH, Reclaimer>*>(engine))
+		function(&myTemplateEngine->GetTable());
+	else
+		return false;
+	return true;
+}
+
+/**
+ * @brief Call function with the SplitOrderedHashTable behind a template engine or a
+ * LockFreeHashTable, so the tests get instantiated for it and call its operations directly.
+ * Other engines are passed as they are.
+ *
+ * @param engine
+ * @param function
+ */
+template <typename Function>
+void WithEngineType(HashTable* engine, Function function) {
+	if (LockFreeHashTable* mySplitHashTable = dynamic_cast<LockFreeHashTable*>(engine))
+		mySplitHashTable->Dispatch(function);
+	else if (!WithTemplateEngineType<NoReclaimer>(engine, function) && !WithTemplateEngineType<HazardPointerReclaimer>(engine, function) && !WithTemplateEngineType<EpochReclaimer>(engine, function))
+		function(engine);
+}
+
 /**
  * @brief Apparently thread safe random number generator from stackoverlfow :P
  *
@@ -53,7 +228,8 @@ int intRand(const int& min, const int& max) {
  * @param myHashTable
  * @param n_threads
  */
-void TestCorrectness(uint32_t n_per_thread, HashTable* myHashTable, int n_threads) {
+template <typename Table>
+void TestCorrectness(uint32_t n_per_thread, Table* myHashTable, int n_threads) {
 	srand(time(NULL));
 	uint32_t random_offset = (uint32_t)rand();
 
@@ -75,6 +251,9 @@ void TestCorrectness(uint32_t n_per_thread, HashTable* myHashTable, int n_thread
 			ret_val = myHashTable->Add(number);
 			assert(!ret_val);
 		}
+#pragma omp barrier
+#pragma omp single
+		assert(myHashTable->Size() == (size_t)n_per_thread * n_threads);
 		for (uint32_t i = 0; i < n_per_thread; i++) {
 			uint32_t number = i + t * n_per_thread + random_offset;
 			ret_val = myHashTable->Contains(number);
@@ -87,9 +266,548 @@ void TestCorrectness(uint32_t n_per_thread, HashTable* myHashTable, int n_thread
 			assert(!ret_val);
 		}
 	}
+	assert(myHashTable->Size() == 0);
+	std::cout << "No assertion violation observed" << std::endl;
+}
+
+/**
+ * @brief Same as TestCorrectness() with the batch operations, every thread passes its whole
+ * region at once and checks every bit of the result.
+ *
+ * @param n_per_thread
+ * @param myHashTable
+ * @param n_threads
+ */
+void TestBatchCorrectness(uint32_t n_per_thread, HashTable* myHashTable, int n_threads) {
+	srand(time(NULL));
+	uint32_t random_offset = (uint32_t)rand();
+
+	omp_set_dynamic(0);
+	omp_set_num_threads(n_threads);
+#pragma omp parallel
+	{
+		int t = omp_get_thread_num();
+		std::vector<ValueType> numbers(2 * n_per_thread);
+		std::vector<uint64_t> bits((2 * n_per_thread + 63) / 64);
+		// first half is our region, second half is never added
+		for (uint32_t i = 0; i < n_per_thread; i++) {
+			numbers[i] = i + t * n_per_thread + random_offset;
+			numbers[n_per_thread + i] = i + (t + n_threads) * n_per_thread + random_offset;
+		}
+		auto Bit = [&bits](uint32_t i) { return (bits[i / 64] >> (i % 64)) & 1; };
+#pragma omp barrier
+		myHashTable->AddBatch(numbers.data(), n_per_thread, bits.data());
+		for (uint32_t i = 0; i < n_per_thread; i++)
+			assert(Bit(i));
+		myHashTable->AddBatch(numbers.data(), n_per_thread, bits.data());
+		for (uint32_t i = 0; i < n_per_thread; i++)
+			assert(!Bit(i));
+		myHashTable->ContainsBatch(numbers.data(), 2 * n_per_thread, bits.data());
+		for (uint32_t i = 0; i < 2 * n_per_thread; i++)
+			assert(Bit(i) == (i < n_per_thread));
+#pragma omp barrier
+		myHashTable->RemoveBatch(numbers.data(), 2 * n_per_thread, bits.data());
+		for (uint32_t i = 0; i < 2 * n_per_thread; i++)
+			assert(Bit(i) == (i < n_per_thread));
+		myHashTable->ContainsBatch(numbers.data(), 2 * n_per_thread, bits.data());
+		for (uint32_t i = 0; i < 2 * n_per_thread; i++)
+			assert(!Bit(i));
+	}
+	assert(myHashTable->Size() == 0);
+	std::cout << "No assertion violation observed" << std::endl;
+}
+
+/**
+ * @brief Check that the vector kernels of every instruction set the CPU supports prepare the
+ * same keys as the scalar hash functions, for every hash function. The count is no multiple
+ * of the vector width, so the scalar tails get checked as well.
+ */
+void TestKeyKernels() {
+	const size_t count = 1003;
+	const KeyType high = (KeyType)1 << (sizeof(KeyType) * 8 - 1);
+	const KeyType key_mask = (KeyType)rand();
+	std::vector<ValueType> values(count);
+	std::vector<KeyType> hashes(count);
+	std::vector<KeyType> keys(count);
+	for (size_t i = 0; i < count; i++)
+		values[i] = (ValueType)(((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 16) ^ (uint64_t)rand());
+	uint64_t seed = RandomSeed();
+
+	SimdLevel supported = GetSupportedSimdLevel();
+	for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512}) {
+		if (level > supported)
+			break;
+		SetSimdLevel(level);
+		for (HashKind hash_kind : {HashKind::MIXER, HashKind::CRC32C, HashKind::WYHASH}) {
+			PrepareKeys(hash_kind, seed, values.data(), count, key_mask, hashes.data(), keys.data());
+			for (size_t i = 0; i < count; i++) {
+				KeyType hash = HashValue(hash_kind, seed, values[i]);
+				assert(hashes[i] == hash);
+				assert(keys[i] == ReverseBits((KeyType)((hash & key_mask) | high)));
+			}
+		}
+	}
+	SetSimdLevel(supported);
+	std::cout << "No assertion violation observed" << std::endl;
+}
+
+/**
+ * @brief Bulk build a table from values that all appear twice, check that every value made it
+ * exactly once, then run concurrent operations on the built table. Building again on the
+ * non-empty table falls back to adding the values, building on the drained table replaces
+ * its list. The table is reserved up front, so the first build replaces the sentinel nodes.
+ *
+ * @param n_elements
+ * @param reclamation
+ * @param hash_kind
+ * @param n_threads
+ */
+void TestBulkBuild(uint32_t n_elements, Reclamation reclamation, HashKind hash_kind, int n_threads) {
+	srand(time(NULL));
+	uint32_t random_offset = (uint32_t)rand();
+	std::vector<ValueType> values(2 * n_elements);
+	for (uint32_t i = 0; i < n_elements; i++) {
+		values[i] = random_offset + i;
+		values[2 * n_elements - 1 - i] = random_offset + i;
+	}
+	LockFreeHashTable myHashTable(n_elements / 2, reclamation, hash_kind);
+	size_t added = myHashTable.BulkBuild(values.data(), values.size(), n_threads);
+	assert(added == n_elements);
+	assert(myHashTable.Size() == n_elements);
+
+	omp_set_dynamic(0);
+	omp_set_num_threads(n_threads);
+#pragma omp parallel for
+	for (uint32_t i = 0; i < n_elements; i++) {
+		ValueType number = random_offset + i;
+		bool ret_val = myHashTable.Contains(number);
+		assert(ret_val);
+		ret_val = myHashTable.Contains(number + n_elements);
+		assert(!ret_val);
+		ret_val = myHashTable.Remove(number);
+		assert(ret_val);
+		ret_val = myHashTable.Add(number + n_elements);
+		assert(ret_val);
+	}
+	assert(myHashTable.Size() == n_elements);
+	added = myHashTable.BulkBuild(values.data(), values.size(), n_threads);
+	assert(added == n_elements);
+	assert(myHashTable.Size() == 2 * (size_t)n_elements);
+
+#pragma omp parallel for
+	for (uint32_t i = 0; i < 2 * n_elements; i++) {
+		bool ret_val = myHashTable.Remove(random_offset + i);
+		assert(ret_val);
+	}
+	assert(myHashTable.Size() == 0);
+	added = myHashTable.BulkBuild(values.data(), values.size(), n_threads);
+	assert(added == n_elements);
+#pragma omp parallel for
+	for (uint32_t i = 0; i < n_elements; i++) {
+		bool ret_val = myHashTable.Contains(random_offset + i);
+		assert(ret_val);
+		ret_val = myHashTable.Contains(random_offset + n_elements + i);
+		assert(!ret_val);
+	}
+	std::cout << "No assertion violation observed" << std::endl;
+}
+
+/**
+ * @brief Fill a table, visit it with ParallelForEach() and check that every element shows up
+ * exactly once, then visit it with ForEach() and the iterator from one thread while the others
+ * keep adding and removing other values. The elements that stay in the table have to show up
+ * exactly once anyway, the churning ones at most once.
+ *
+ * @param n_elements
+ * @param reclamation
+ * @param hash_kind
+ * @param n_threads
+ */
+void TestForEach(uint32_t n_elements, Reclamation reclamation, HashKind hash_kind, int n_threads) {
+	srand(time(NULL));
+	uint32_t random_offset = (uint32_t)rand();
+	LockFreeHashTable myHashTable(0, reclamation, hash_kind);
+	std::vector<std::atomic<uint32_t>> seen(2 * n_elements);
+	auto Count = [&](ValueType value) {
+		uint32_t index = (uint32_t)(value - random_offset);
+		assert(index < 2 * n_elements);
+		seen[index].fetch_add(1);
+	};
+
+	omp_set_dynamic(0);
+	omp_set_num_threads(n_threads);
+#pragma omp parallel for
+	for (uint32_t i = 0; i < n_elements; i++) {
+		bool ret_val = myHashTable.Add(random_offset + i);
+		assert(ret_val);
+	}
+	myHashTable.ParallelForEach(Count, n_threads);
+	for (uint32_t i = 0; i < n_elements; i++)
+		assert(seen[i].load() == 1);
+
+	for (int pass = 0; pass < 2; pass++) {
+		for (uint32_t i = 0; i < 2 * n_elements; i++)
+			seen[i].store(0);
+		std::atomic<bool> done(false);
+#pragma omp parallel
+		{
+			int t = omp_get_thread_num();
+			if (t == 0) {
+				if (pass == 0) {
+					myHashTable.ForEach(Count);
+				}
+				else {
+					LockFreeHashTableIterator iterator(&myHashTable);
+					ValueType value;
+					while (iterator.Next(&value))
+						Count(value);
+				}
+				done.store(true);
+			}
+			else {
+				// every thread churns its own slice of the second half, so no other thread interferes
+				for (uint32_t i = t; !done.load(); i = i + n_threads < n_elements ? i + n_threads : t) {
+					ValueType number = random_offset + n_elements + i;
+					bool ret_val = myHashTable.Add(number);
+					assert(ret_val);
+					ret_val = myHashTable.Remove(number);
+					assert(ret_val);
+				}
+			}
+		}
+		for (uint32_t i = 0; i < n_elements; i++) {
+			assert(seen[i].load() == 1);
+			assert(seen[n_elements + i].load() <= 1);
+		}
+	}
+	assert(myHashTable.Size() == n_elements);
+	std::cout << "No assertion violation observed" << std::endl;
+}
+
+/**
+ * @brief Save a table that went through adds and removes, load the snapshot and check that the
+ * loaded table holds exactly the same elements, hashes like the saved one and takes concurrent
+ * operations. Truncated snapshots and missing files must not load.
+ *
+ * @param n_elements
+ * @param reclamation
+ * @param hash_kind
+ * @param n_threads
+ */
+void TestSnapshot(uint32_t n_elements, Reclamation reclamation, HashKind hash_kind, int n_threads) {
+	srand(time(NULL));
+	uint32_t random_offset = (uint32_t)rand();
+	std::string path = "/tmp/split_order_snapshot_" + std::to_string(random_offset);
+	LockFreeHashTable mySavedHashTable(reclamation, hash_kind);
+
+	omp_set_dynamic(0);
+	omp_set_num_threads(n_threads);
+#pragma omp parallel for
+	for (uint32_t i = 0; i < 2 * n_elements; i++) {
+		bool ret_val = mySavedHashTable.Add(random_offset + i);
+		assert(ret_val);
+	}
+#pragma omp parallel for
+	for (uint32_t i = 0; i < n_elements; i++) {
+		bool ret_val = mySavedHashTable.Remove(random_offset + 2 * i);
+		assert(ret_val);
+	}
+	bool ret_val = mySavedHashTable.SaveSnapshot(path);
+	assert(ret_val);
+
+	LockFreeHashTable* myHashTable = LockFreeHashTable::LoadSnapshot(path, reclamation);
+	assert(myHashTable != nullptr);
+	assert(myHashTable->Size() == n_elements);
+	assert(myHashTable->GetHashKind() == hash_kind);
+	assert(myHashTable->GetSeed() == mySavedHashTable.GetSeed());
+#pragma omp parallel for
+	for (uint32_t i = 0; i < 2 * n_elements; i++) {
+		ValueType number = random_offset + i;
+		bool ret_val = myHashTable->Contains(number);
+		assert(ret_val == (i % 2 == 1));
+		ret_val = myHashTable->Remove(number);
+		assert(ret_val == (i % 2 == 1));
+		ret_val = myHashTable->Add(number + 2 * n_elements);
+		assert(ret_val);
+	}
+	assert(myHashTable->Size() == 2 * (size_t)n_elements);
+	delete myHashTable;
+
+	ret_val = truncate(path.c_str(), sizeof(SnapshotHeader) + sizeof(KeyValue) / 2) == 0;
+	assert(ret_val);
+	assert(LockFreeHashTable::LoadSnapshot(path, reclamation) == nullptr);
+	remove(path.c_str());
+	assert(LockFreeHashTable::LoadSnapshot(path, reclamation) == nullptr);
+	std::cout << "No assertion violation observed" << std::endl;
+}
+
+/**
+ * @brief Same as TestCorrectness() for the key/value map, additionally checking that
+ * Find() returns the value stored with a key and that Replace() only replaces the expected one.
+ *
+ * @param n_per_thread
+ * @param n_threads
+ * @param MakeValue Value stored for a key.
+ */
+template <typename V>
+void TestMapCorrectness(uint32_t n_per_thread, int n_threads, V (*MakeValue)(uint32_t)) {
+	LockFreeHashMap<uint32_t, V, WyHash<uint32_t>> map;
+	srand(time(NULL));
+	uint32_t random_offset = (uint32_t)rand();
+
+	omp_set_dynamic(0);
+	omp_set_num_threads(n_threads);
+#pragma omp parallel
+	{
+		int t = omp_get_thread_num();
+#pragma omp barrier
+		bool ret_val;
+		V value;
+		for (uint32_t i = 0; i < n_per_thread; i++) {
+			uint32_t number = i + t * n_per_thread + random_offset;
+			ret_val = map.Find(number, value);
+			assert(!ret_val);
+			ret_val = map.Insert(number, MakeValue(number));
+			assert(ret_val);
+			ret_val = map.Find(number, value);
+			assert(ret_val && value == MakeValue(number));
+			ret_val = map.Insert(number, MakeValue(number + 1));
+			assert(!ret_val);
+		}
+#pragma omp barrier
+#pragma omp single
+		assert(map.Size() == (size_t)n_per_thread * n_threads);
+		for (uint32_t i = 0; i < n_per_thread; i++) {
+			uint32_t number = i + t * n_per_thread + random_offset;
+			ret_val = map.Find(number, value);
+			assert(ret_val && value == MakeValue(number));
+			ret_val = map.Replace(number, MakeValue(number), MakeValue(number + 1));
+			assert(ret_val);
+			ret_val = map.Replace(number, MakeValue(number), MakeValue(number + 2));
+			assert(!ret_val);
+			ret_val = map.Find(number, value);
+			assert(ret_val && value == MakeValue(number + 1));
+			ret_val = map.Erase(number);
+			assert(ret_val);
+			ret_val = map.Contains(number);
+			assert(!ret_val);
+			ret_val = map.Erase(number);
+			assert(!ret_val);
+		}
+	}
+	assert(map.Size() == 0);
+	std::cout << "No assertion violation observed" << std::endl;
+}
+
+uint64_t MakeInlineValue(uint32_t key) {
+	return (uint64_t)key * 3;
+}
+
+std::string MakeBoxedValue(uint32_t key) {
+	return "value " + std::to_string(key);
+}
+
+/**
+ * @brief Test the read-modify-write operations of a key/value map. All threads increment the
+ * same counters, half of them with FetchAdd() and half of them with a Replace() loop, and race
+ * on ComputeIfAbsent() and PutIfAbsent() of the same keys. No increment may get lost and all
+ * threads have to see the same winner.
+ *
+ * @param n_per_thread Increments per thread, a multiple of N_COUNTERS.
+ * @param map
+ * @param n_threads
+ */
+template <typename Map>
+void TestUpsertCorrectness(uint32_t n_per_thread, Map* map, int n_threads) {
+	const uint32_t N_COUNTERS = 100;
+	const ValueType COMPUTED_KEY = 2 * N_COUNTERS;
+	const ValueType PUT_KEY = 2 * N_COUNTERS + 1;
+	ValueType winners[n_threads];
+
+	omp_set_dynamic(0);
+	omp_set_num_threads(n_threads);
+#pragma omp parallel
+	{
+		int t = omp_get_thread_num();
+#pragma omp barrier
+		for (uint32_t i = 0; i < n_per_thread; i++) {
+			map->FetchAdd(i % N_COUNTERS, 1);
+			ValueType key = N_COUNTERS + i % N_COUNTERS;
+			ValueType existing = 0;
+			if (!map->PutIfAbsent(key, 1, existing)) {
+				while (!map->Replace(key, existing, existing + 1)) {
+					existing = map->FetchAdd(key, 0);
+				}
+			}
+		}
+		ValueType computed = map->ComputeIfAbsent(COMPUTED_KEY, [t]() { return (ValueType)t; });
+		ValueType existing = t;
+		map->PutIfAbsent(PUT_KEY, t, existing);
+		assert(computed == map->FetchAdd(COMPUTED_KEY, 0));
+		assert(existing == map->FetchAdd(PUT_KEY, 0));
+		winners[t] = computed;
+	}
+	for (ValueType key = 0; key < 2 * N_COUNTERS; key++)
+		assert(map->FetchAdd(key, 0) == n_per_thread / N_COUNTERS * n_threads);
+	for (int t = 0; t < n_threads; t++)
+		assert(winners[t] == winners[0]);
 	std::cout << "No assertion violation observed" << std::endl;
 }
 
+/**
+ * @brief Test throughput of FetchAdd() on a small set of counters shared by all threads.
+ *
+ * @param time_limit
+ * @param map
+ * @param n_threads
+ * @return int number of operations of all threads
+ */
+template <typename Map>
+int TestUpsertThroughput(double time_limit, Map* map, int n_threads) {
+	omp_set_dynamic(0);
+	omp_set_num_threads(n_threads);
+	int operation_count[n_threads];
+#pragma omp parallel
+	{
+		int t = omp_get_thread_num();
+		int local_operation_count = 0;
+		double start, now;
+#pragma omp barrier
+		start = omp_get_wtime();
+		now = omp_get_wtime();
+		while ((now - start) < time_limit) {
+			map->FetchAdd(intRand(0, 1000), 1);
+			local_operation_count++;
+			now = omp_get_wtime();
+		}
+#pragma omp barrier
+		operation_count[t] = local_operation_count;
+	}
+	int ret = 0;
+	for (int i = 0; i < n_threads; i++) {
+		ret += operation_count[i];
+	}
+	std::cout << std::to_string(ret) << " operations" << std::endl;
+	return ret;
+}
+
+/**
+ * @brief Test throughput of ContainsBatch(). The table gets the even numbers below 2 * n_elements,
+ * then the threads look up batches of random numbers from that range, so about half of them hit.
+ *
+ * @param time_limit
+ * @param myHashTable
+ * @param n_threads
+ * @param batch_size
+ * @return int number of looked up values of all threads
+ */
+int TestBatchThroughput(double time_limit, HashTable* myHashTable, int n_threads, uint32_t batch_size) {
+	const int n_elements = 1000000;
+	omp_set_dynamic(0);
+	omp_set_num_threads(n_threads);
+#pragma omp parallel for
+	for (int i = 0; i < n_elements; i++) {
+		myHashTable->Add(2 * i);
+	}
+
+	int operation_count[n_threads];
+#pragma omp parallel
+	{
+		int t = omp_get_thread_num();
+		int local_operation_count = 0;
+		std::vector<ValueType> numbers(batch_size);
+		std::vector<uint64_t> bits((batch_size + 63) / 64);
+		double start, now;
+#pragma omp barrier
+		start = omp_get_wtime();
+		now = omp_get_wtime();
+		while ((now - start) < time_limit) {
+			for (uint32_t i = 0; i < batch_size; i++)
+				numbers[i] = intRand(0, 2 * n_elements - 1);
+			myHashTable->ContainsBatch(numbers.data(), batch_size, bits.data());
+			local_operation_count += batch_size;
+			now = omp_get_wtime();
+		}
+#pragma omp barrier
+		operation_count[t] = local_operation_count;
+	}
+	int ret = 0;
+	for (int i = 0; i < n_threads; i++) {
+		ret += operation_count[i];
+	}
+	std::cout << std::to_string(ret) << " operations" << std::endl;
+	return ret;
+}
+
+/**
+ * @brief Time filling a fresh lock-free hashtable with BulkBuild() and with parallel Add() calls,
+ * once with the directory growing as usual and once with the table reserved up front.
+ *
+ * @param n_elements
+ * @param reclamation
+ * @param hash_kind
+ * @param n_threads
+ */
+void TestBulkBuildTime(uint32_t n_elements, Reclamation reclamation, HashKind hash_kind, int n_threads) {
+	std::vector<ValueType> values(n_elements);
+	for (uint32_t i = 0; i < n_elements; i++)
+		values[i] = i;
+
+	LockFreeHashTable* myHashTable = new LockFreeHashTable(reclamation, hash_kind);
+	double start = omp_get_wtime();
+	myHashTable->BulkBuild(values.data(), n_elements, n_threads);
+	double bulk_build_time = omp_get_wtime() - start;
+	delete myHashTable;
+
+	myHashTable = new LockFreeHashTable(reclamation, hash_kind);
+	omp_set_dynamic(0);
+	omp_set_num_threads(n_threads);
+	start = omp_get_wtime();
+#pragma omp parallel for
+	for (uint32_t i = 0; i < n_elements; i++) {
+		myHashTable->Add(values[i]);
+	}
+	double add_time = omp_get_wtime() - start;
+	delete myHashTable;
+
+	start = omp_get_wtime();
+	myHashTable = new LockFreeHashTable(n_elements, reclamation, hash_kind);
+	double reserve_time = omp_get_wtime() - start;
+#pragma omp parallel for
+	for (uint32_t i = 0; i < n_elements; i++) {
+		myHashTable->Add(values[i]);
+	}
+	double reserved_add_time = omp_get_wtime() - start;
+	delete myHashTable;
+	std::cout << "\nBuilding a table of " << n_elements << " elements: BulkBuild() " << FIXED_DOUBLE(bulk_build_time * 1000)
+	          << " ms, Add() " << FIXED_DOUBLE(add_time * 1000) << " ms, Add() after Reserve() " << FIXED_DOUBLE(reserved_add_time * 1000)
+	          << " ms of which Reserve() " << FIXED_DOUBLE(reserve_time * 1000) << " ms" << std::endl;
+}
+
+/**
+ * @brief Fill a fresh lock-free hashtable in parallel and print how many bytes its linked nodes
+ * and its directory take per element, along with everything the node pool holds by now.
+ *
+ * @param n_elements
+ * @param reclamation
+ * @param hash_kind
+ * @param n_threads
+ */
+void TestMemoryPerElement(uint32_t n_elements, Reclamation reclamation, HashKind hash_kind, int n_threads) {
+	LockFreeHashTable myHashTable(reclamation, hash_kind);
+
+	omp_set_dynamic(0);
+	omp_set_num_threads(n_threads);
+#pragma omp parallel for
+	for (uint32_t i = 0; i < n_elements; i++) {
+		myHashTable.Add(i);
+	}
+	double used = (double)myHashTable.GetMemoryUsage() / n_elements;
+	double reserved = (double)NodePool::GetReservedBytes() / (1024 * 1024);
+	std::cout << "\nMemory per element: " << FIXED_DOUBLE(used) << " bytes in nodes and directory, "
+	          << "node pool reserved " << FIXED_DOUBLE(reserved) << " MiB in total" << std::endl;
+}
+
 /**
  * @brief Test throughput, similar to TestCorrectness() every thread has its own regions
  * of elements. Which means that the retry_counters are zero most of the time or a very low value otherwise.
@@ -99,7 +817,8 @@ void TestCorrectness(uint32_t n_per_thread, HashTable* myHashTable, int n_thread
  * @param n_threads
  * @return int number of operations of all threads
  */
-int TestThroughputLocalRegions(double time_limit, HashTable* myHashTable, int n_threads) {
+template <typename Table>
+int TestThroughputLocalRegions(double time_limit, Table* myHashTable, int n_threads) {
 	srand(time(NULL));
 	uint32_t random_offset = (uint32_t)rand();
 
@@ -146,13 +865,15 @@ int TestThroughputLocalRegions(double time_limit, HashTable* myHashTable, int n_
 	return ret;
 }
 
-int TestThroughputSameRegion(double time_limit, HashTable* myHashTable, int n_threads) {
+template <typename Table>
+int TestThroughputSameRegion(double time_limit, Table* myHashTable, int n_threads) {
 	srand(time(NULL));
 	uint32_t random_offset = (uint32_t)rand();
 
 	omp_set_dynamic(0);
 	omp_set_num_threads(n_threads);
 	int operation_count[n_threads];
+	uint64_t retry_count[n_threads];
 #pragma omp parallel
 	{
 		int t = omp_get_thread_num();
@@ -160,6 +881,7 @@ int TestThroughputSameRegion(double time_limit, HashTable* myHashTable, int n_th
 		int RANDOM_MIN = random_offset;
 		int RANDOM_MAX = random_offset + 100000;
 		int local_operation_count = 0;
+		uint64_t retries_before = GetListThreadRetries();
 		double start, now;
 #pragma omp barrier
 		start = omp_get_wtime();
@@ -177,16 +899,25 @@ int TestThroughputSameRegion(double time_limit, HashTable* myHashTable, int n_th
 		}
 #pragma omp barrier
 		operation_count[t] = local_operation_count;
+		retry_count[t] = GetListThreadRetries() - retries_before;
 	}
 	int ret = 0;
+	uint64_t retries = 0;
+	uint64_t max_retries = 0;
 	for (int i = 0; i < n_threads; i++) {
 		ret += operation_count[i];
+		retries += retry_count[i];
+		max_retries = std::max(max_retries, retry_count[i]);
 	}
-	std::cout << std::to_string(ret) << " operations" << std::endl;
+	std::cout << std::to_string(ret) << " operations";
+	if (retries > 0)
+		std::cout << ", " << retries << " CAS retries, at most " << max_retries << " per thread";
+	std::cout << std::endl;
 	return ret;
 }
 
-std::vector<uint64_t> TestVarLoadFactor(double time_limit_per_load_fact, HashTable* myHashTable, int n_threads) {
+template <typename Table>
+std::vector<uint64_t> TestVarLoadFactor(double time_limit_per_load_fact, Table* myHashTable, int n_threads) {
 	srand(time(NULL));
 
 	double load_factors[8][3] = {
@@ -269,9 +1000,18 @@ int main(int argc, char* argv[]) {
 	bool record_times = false;
 	bool all_same_region = false;
 	bool var_load_factor = false;
+	bool upserts = false;
+	uint32_t batch_size = 0;
+	bool bulk_build = false;
+	size_t expected_size = 0;
+	ContentionManagement contention = DEFAULT_CONTENTION_MANAGEMENT;
+	const Baseline* baseline = &BASELINES[0];
+	Reclamation reclamation = Reclamation::HAZARD_POINTERS;
+	HashKind hash_kind = HashKind::MIXER;
+	const Engine* engine = &ENGINES[0];
 
 	while (true) {
-		switch (getopt(argc, argv, "grvci:t:s:h")) {
+		switch (getopt(argc, argv, "grvulci:t:s:m:f:e:b:p:x:o:h")) {
 		case 'i':
 			n_iterations = std::stoi(optarg);
 			continue;
@@ -293,6 +1033,72 @@ int main(int argc, char* argv[]) {
 		case 'v':
 			var_load_factor = true;
 			continue;
+		case 'u':
+			upserts = true;
+			continue;
+		case 'o':
+			baseline = FindBaseline(std::string(optarg));
+			if (baseline == nullptr) {
+				Usage(std::string(argv[0]));
+				return 0;
+			}
+			continue;
+		case 'x':
+			if (std::string(optarg) == "none") {
+				contention = NO_CONTENTION_MANAGEMENT;
+			} else if (std::string(optarg) == "backoff") {
+				contention = DEFAULT_CONTENTION_MANAGEMENT;
+				contention.resume_from_pred = false;
+			} else if (std::string(optarg) == "resume") {
+				contention = NO_CONTENTION_MANAGEMENT;
+				contention.resume_from_pred = true;
+			} else if (std::string(optarg) == "all") {
+				contention = DEFAULT_CONTENTION_MANAGEMENT;
+			} else {
+				Usage(std::string(argv[0]));
+				return 0;
+			}
+			continue;
+		case 'p':
+			expected_size = std::stoul(optarg);
+			continue;
+		case 'l':
+			bulk_build = true;
+			continue;
+		case 'b':
+			batch_size = std::stoi(optarg);
+			continue;
+		case 'm':
+			if (std::string(optarg) == "none") {
+				reclamation = Reclamation::NONE;
+			} else if (std::string(optarg) == "hp") {
+				reclamation = Reclamation::HAZARD_POINTERS;
+			} else if (std::string(optarg) == "epoch") {
+				reclamation = Reclamation::EPOCH;
+			} else {
+				Usage(std::string(argv[0]));
+				return 0;
+			}
+			continue;
+		case 'f':
+			if (std::string(optarg) == "mixer") {
+				hash_kind = HashKind::MIXER;
+			} else if (std::string(optarg) == "crc32c") {
+				hash_kind = HashKind::CRC32C;
+			} else if (std::string(optarg) == "wyhash") {
+				hash_kind = HashKind::WYHASH;
+			} else {
+				Usage(std::string(argv[0]));
+				return 0;
+			}
+			continue;
+		case 'e':
+			engine = FindEngine(std::string(optarg));
+			if (engine == nullptr) {
+				Usage(std::string(argv[0]));
+				return 0;
+			}
+			continue;
 		case '?':
 		case 'h':
 		default:
@@ -327,43 +1133,105 @@ int main(int argc, char* argv[]) {
 	std::cout << "Number of iterations: " << std::to_string(n_iterations) << std::endl;
 	std::cout << "Number of threads: " << std::to_string(n_threads) << std::endl;
 	std::cout << "Number of seconds: " << std::to_string(time_limit_seconds) << std::endl;
+	std::cout << "Memory reclamation: " << ReclamationName(reclamation) << std::endl;
+	std::cout << "Hash function: " << HashKindName(hash_kind) << std::endl;
+	if (!test_correctness) {
+		std::cout << "Engine: " << engine->description << std::endl;
+		std::cout << "Baseline: " << baseline->description << std::endl;
+	}
 	if (test_correctness)
 		std::cout << "Testing for correctness" << std::endl;
 	else
 		std::cout << "Testing throughput" << std::endl;
 
-	auto ThroughputFunction = &TestThroughputLocalRegions;
-	auto VarThroughputFunction = &TestVarLoadFactor;
-	if (all_same_region)
-		ThroughputFunction = &TestThroughputSameRegion;
+	auto ThroughputFunction = [all_same_region](double time_limit, auto* myHashTable, int n_threads) {
+		if (all_same_region)
+			return TestThroughputSameRegion(time_limit, myHashTable, n_threads);
+		return TestThroughputLocalRegions(time_limit, myHashTable, n_threads);
+	};
+	auto VarThroughputFunction = [](double time_limit, auto* myHashTable, int n_threads) { return TestVarLoadFactor(time_limit, myHashTable, n_threads); };
 
 	for (int i = 0; i < n_iterations; i++) {
 		std::cout << "\n\tIteration " << i << std::endl;
-		LockFreeHashTable* myLockFreeHashTable = new LockFreeHashTable();
+		HashTable* myLockFreeHashTable = engine->make(reclamation, hash_kind);
+		if (LockFreeHashTable* mySplitHashTable = dynamic_cast<LockFreeHashTable*>(myLockFreeHashTable))
+			mySplitHashTable->SetContentionManagement(contention);
+		myLockFreeHashTable->Reserve(expected_size);
 		std::cout << "Lock Free Hashtable:  ";
 
 		int num_operations_lock_free;
 		std::vector<uint64_t> num_var_operations_lock_free;
 
-		if (test_correctness)
-			TestCorrectness(5000, myLockFreeHashTable, n_threads);
+		if (test_correctness) {
+			WithEngineType(myLockFreeHashTable, [&](auto* table) { TestCorrectness(5000, table, n_threads); });
+			for (const Engine& other_engine : ENGINES) {
+				if (&other_engine == engine)
+					continue;
+				HashTable* myOtherHashTable = other_engine.make(reclamation, hash_kind);
+				std::cout << "Lock Free Hashtable, " << other_engine.name << ": ";
+				WithEngineType(myOtherHashTable, [&](auto* table) { TestCorrectness(5000, table, n_threads); });
+				delete myOtherHashTable;
+			}
+			std::cout << "Key kernels:                  ";
+			TestKeyKernels();
+			HashTable* myBatchHashTable = engine->make(reclamation, hash_kind);
+			std::cout << "Lock Free Hashtable, batches: ";
+			TestBatchCorrectness(5000, myBatchHashTable, n_threads);
+			delete myBatchHashTable;
+			std::cout << "Lock Free Hashtable, bulk build: ";
+			TestBulkBuild(20000, reclamation, hash_kind, n_threads);
+			std::cout << "Lock Free Hashtable, for each: ";
+			TestForEach(20000, reclamation, hash_kind, n_threads);
+			std::cout << "Lock Free Hashtable, snapshot: ";
+			TestSnapshot(20000, reclamation, hash_kind, n_threads);
+			std::cout << "Lock Free Hashmap, inline values: ";
+			TestMapCorrectness(5000, n_threads, &MakeInlineValue);
+			std::cout << "Lock Free Hashmap, boxed values:  ";
+			TestMapCorrectness(5000, n_threads, &MakeBoxedValue);
+			LockFreeHashMap<ValueType, ValueType> myLockFreeHashMap;
+			std::cout << "Lock Free Hashmap, upserts:       ";
+			TestUpsertCorrectness(5000, &myLockFreeHashMap, n_threads);
+			for (const Baseline& other_baseline : BASELINES) {
+				HashTable* myLockBasedHashTable = other_baseline.make(hash_kind);
+				std::cout << "Lock Based Hashtable, " << other_baseline.name << ": ";
+				TestCorrectness(5000, myLockBasedHashTable, n_threads);
+				delete myLockBasedHashTable;
+				myLockBasedHashTable = other_baseline.make(hash_kind);
+				std::cout << "Lock Based Hashtable, " << other_baseline.name << " upserts: ";
+				WithBaselineType(myLockBasedHashTable, [&](auto* map) { TestUpsertCorrectness(5000, map, n_threads); });
+				delete myLockBasedHashTable;
+			}
+		}
+		else if (upserts) {
+			LockFreeHashMap<ValueType, ValueType> myLockFreeHashMap;
+			num_operations_lock_free = TestUpsertThroughput((double)time_limit_seconds, &myLockFreeHashMap, n_threads);
+		}
+		else if (batch_size > 0)
+			num_operations_lock_free = TestBatchThroughput((double)time_limit_seconds, myLockFreeHashTable, n_threads, batch_size);
 		else if (var_load_factor)
-			num_var_operations_lock_free = VarThroughputFunction((double)time_limit_seconds, myLockFreeHashTable, n_threads);
+			WithEngineType(myLockFreeHashTable, [&](auto* table) { num_var_operations_lock_free = VarThroughputFunction((double)time_limit_seconds, table, n_threads); });
 		else
-			num_operations_lock_free = ThroughputFunction((double)time_limit_seconds, myLockFreeHashTable, n_threads);
+			WithEngineType(myLockFreeHashTable, [&](auto* table) { num_operations_lock_free = ThroughputFunction((double)time_limit_seconds, table, n_threads); });
 
 		int num_operations_lock_based;
 		std::vector<uint64_t> num_var_operations_lock_based;
 
 		if (!test_correctness) {
-			LockBasedHashTable* myLockBasedHashTable = new LockBasedHashTable();
+			HashTable* myLockBasedHashTable = baseline->make(hash_kind);
+			myLockBasedHashTable->Reserve(expected_size);
 			std::cout << "Lock Based Hashtable: ";
-			if (var_load_factor) {
+			if (upserts) {
+				WithBaselineType(myLockBasedHashTable, [&](auto* map) { num_operations_lock_based = TestUpsertThroughput((double)time_limit_seconds, map, n_threads); });
+			} else if (batch_size > 0) {
+				num_operations_lock_based = TestBatchThroughput((double)time_limit_seconds, myLockBasedHashTable, n_threads, batch_size);
+			} else if (var_load_factor) {
 				num_var_operations_lock_based = VarThroughputFunction((double)time_limit_seconds, myLockBasedHashTable, n_threads);
 			} else {
 				num_operations_lock_based = ThroughputFunction((double)time_limit_seconds, myLockBasedHashTable, n_threads);
 			}
+			delete myLockBasedHashTable;
 		}
+		delete myLockFreeHashTable;
 
 		if (record_times) {
 			outputfile << std::to_string(num_operations_lock_free) << "," << std::to_string(num_operations_lock_based) << ",";
@@ -372,5 +1240,10 @@ int main(int argc, char* argv[]) {
 	}
 	if (record_times)
 		outputfile.close();
+	// last, since the nodes of the filled table end up scattered over the free lists
+	if (!test_correctness && !upserts && batch_size == 0 && engine == &ENGINES[0])
+		TestMemoryPerElement(1000000, reclamation, hash_kind, n_threads);
+	if (bulk_build)
+		TestBulkBuildTime(4000000, reclamation, hash_kind, n_threads);
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,152 @@
+/**
+ * @file node_pool.cpp
+ * @author Josef Salzmann &	Aleksandar Hadzhiyski
+ * @brief Per-thread slab allocator for list nodes.
+ * @date 2026-10-15
+ */
+#include "node_pool.h"
+
+std::mutex NodePool::global_mutex;
+std::vector<NodeBatch> NodePool::global_batches;
+std::vector<void*> NodePool::slabs;
+
+// Set once the NodeCache of the thread is gone. The thread local reclamation records may be
+// destroyed after the cache and still free nodes, which then bypass the stale cache. It lives
+// outside the cache, since stores to an object in its own destructor may be optimized away.
+static thread_local bool node_cache_destroyed = false;
+
+/**
+ * @brief The thread local part of the pool: a LIFO free list and the unused rest of
+ * the current slab. On thread exit everything is handed to the global pool.
+ */
+struct NodeCache {
+	NodeType* free_list = nullptr;
+	uint32_t free_count = 0;
+	char* slab_cursor = nullptr;
+	char* slab_end = nullptr;
+
+	~NodeCache() {
+		node_cache_destroyed = true;
+		while (slab_cursor + sizeof(NodeType) <= slab_end) {
+			NodeType* node = reinterpret_cast<NodeType*>(slab_cursor);
+			node->next.store(free_list, std::memory_order_relaxed);
+			free_list = node;
+			free_count++;
+			slab_cursor += sizeof(NodeType);
+		}
+		if (free_count == 0)
+			return;
+		std::lock_guard<std::mutex> lock(NodePool::global_mutex);
+		NodePool::global_batches.push_back({free_list, free_count});
+	}
+};
+
+static thread_local NodeCache node_cache;
+
+/**
+ * @brief Return an initialized node. Since the free list is LIFO, a node freed
+ * by a failed Add() is exactly the one the next Add() of this thread gets.
+ *
+ * @return NodeType*
+ */
+NodeType* NodePool::Allocate() {
+	if (node_cache_destroyed) {
+		NodeCache scratch;  // hands whatever it does not need back to the global pool
+		return new (Refill(&scratch)) NodeType();
+	}
+	NodeCache* cache = &node_cache;
+	NodeType* node = cache->free_list;
+	if (node != nullptr) {
+		cache->free_list = node->next.load(std::memory_order_relaxed);
+		cache->free_count--;
+	} else if (cache->slab_cursor + sizeof(NodeType) <= cache->slab_end) {
+		node = reinterpret_cast<NodeType*>(cache->slab_cursor);
+		cache->slab_cursor += sizeof(NodeType);
+	} else {
+		node = Refill(cache);
+	}
+	return new (node) NodeType();
+}
+
+/**
+ * @brief Put a node on the free list of the calling thread. If the list grew
+ * beyond two batches, one batch goes to the global pool. After the thread's cache
+ * is gone, the node goes to the global pool on its own.
+ *
+ * @param node
+ */
+void NodePool::Free(NodeType* node) {
+	if (node_cache_destroyed) {
+		node->next.store(nullptr, std::memory_order_relaxed);
+		std::lock_guard<std::mutex> lock(global_mutex);
+		global_batches.push_back({node, 1});
+		return;
+	}
+	NodeCache* cache = &node_cache;
+	node->next.store(cache->free_list, std::memory_order_relaxed);
+	cache->free_list = node;
+	cache->free_count++;
+	if (cache->free_count < 2 * BATCH_SIZE)
+		return;
+
+	NodeBatch batch = {cache->free_list, BATCH_SIZE};
+	NodeType* last = cache->free_list;
+	for (uint32_t i = 1; i < BATCH_SIZE; i++)
+		last = last->next.load(std::memory_order_relaxed);
+	cache->free_list = last->next.load(std::memory_order_relaxed);
+	cache->free_count -= BATCH_SIZE;
+	last->next.store(nullptr, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(global_mutex);
+	global_batches.push_back(batch);
+}
+
+/**
+ * @brief Same as Free(), with the signature the reclamation schemes expect.
+ *
+ * @param node
+ */
+void NodePool::FreeDeleter(void* node) {
+	Free(static_cast<NodeType*>(node));
+}
+
+/**
+ * @brief Slow path of Allocate(): take a batch from the global pool if there is one,
+ * otherwise carve nodes out of a fresh slab.
+ *
+ * @param cache
+ * @return NodeType* an uninitialized node
+ */
+NodeType* NodePool::Refill(NodeCache* cache) {
+	{
+		std::lock_guard<std::mutex> lock(global_mutex);
+		if (!global_batches.empty()) {
+			NodeBatch batch = global_batches.back();
+			global_batches.pop_back();
+			NodeType* node = batch.head;
+			cache->free_list = node->next.load(std::memory_order_relaxed);
+			cache->free_count = batch.count - 1;
+			return node;
+		}
+	}
+	char* slab = static_cast<char*>(aligned_alloc(CACHE_LINE_SIZE, SLAB_SIZE));
+	if (slab == nullptr)
+		throw std::bad_alloc();
+	{
+		std::lock_guard<std::mutex> lock(global_mutex);
+		slabs.push_back(slab);
+	}
+	cache->slab_cursor = slab + sizeof(NodeType);
+	cache->slab_end = slab + SLAB_SIZE;
+	return reinterpret_cast<NodeType*>(slab);
+}
+
+/**
+ * @brief Bytes of all slabs, whether their nodes are in use, free or not handed out yet.
+ *
+ * @return size_t
+ */
+size_t NodePool::GetReservedBytes() {
+	std::lock_guard<std::mutex> lock(global_mutex);
+	return slabs.size() * SLAB_SIZE;
+}
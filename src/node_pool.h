@@ -0,0 +1,45 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "lock_free_list.h"
+
+struct NodeCache;
+
+struct NodeBatch {
+	NodeType* head;  // chained through the next pointers
+	uint32_t count;
+};
+
+/**
+ * Per-thread slab allocator for list nodes. Every thread carves nodes out of its own
+ * cache line aligned slabs and keeps freed nodes in a private LIFO free list, so neither
+ * allocation nor deallocation touches shared state on the fast path. Overfull free lists
+ * hand batches to a global pool from which threads that run dry refill.
+ * Slabs are never returned to the system, the memory stays reserved for later nodes.
+ */
+class NodePool {
+   private:
+	static const uint32_t CACHE_LINE_SIZE = 64;
+	static const uint32_t SLAB_SIZE = 64 * 1024;  // bytes per slab
+	static const uint32_t BATCH_SIZE = 1024;      // nodes moved between a thread and the global pool at once
+	static std::mutex global_mutex;
+	static std::vector<NodeBatch> global_batches;
+	static std::vector<void*> slabs;
+	static NodeType* Refill(NodeCache* cache);
+	friend struct NodeCache;
+
+   public:
+	static NodeType* Allocate();
+	static void Free(NodeType* node);
+	static void FreeDeleter(void* node);
+	static size_t GetReservedBytes();
+};
+
+#endif
@@ -0,0 +1,281 @@
+/**
+ * @file open_addressing_hashtable.cpp
+ * @author Josef Salzmann &	Aleksandar Hadzhiyski
+ * @brief Lock-free hashtable with linear probing, tombstones and incremental migration.
+ * @date 2026-10-15
+ */
+#include "open_addressing_hashtable.h"
+
+#ifndef SPLIT_ORDER_KEYS_64
+
+#include <sstream>
+
+#include "epoch_reclamation.h"
+
+/**
+ * @brief Construct a new table with an empty slot array.
+ *
+ * @param hash_kind Hash function used for the values.
+ * @param seed Seed of the hash function, random unless given.
+ */
+OpenAddressingHashTable::OpenAddressingHashTable(HashKind hash_kind, uint64_t seed) : hash_kind(hash_kind), seed(seed), table(new OpenAddressingTable(INITIAL_CAPACITY)) {}
+
+/**
+ * @brief Free the slot arrays. Only safe once no other thread accesses the table.
+ */
+OpenAddressingHashTable::~OpenAddressingHashTable() {
+	OpenAddressingTable* current = table.load();
+	delete current->next.load();
+	delete current;
+}
+
+KeyType OpenAddressingHashTable::HashFunction(ValueType value) {
+	return HashValue(hash_kind, seed, value);
+}
+
+void OpenAddressingHashTable::DeleteTable(void* table) {
+	delete static_cast<OpenAddressingTable*>(table);
+}
+
+/**
+ * @brief Allocate the array the slots of current get migrated to, unless another thread did so
+ * already. The new array doubles the capacity if more than a quarter of the slots hold elements,
+ * otherwise it has the same capacity and the migration only drops the tombstones.
+ *
+ * @param current
+ */
+void OpenAddressingHashTable::StartMigration(OpenAddressingTable* current) {
+	if (current->next.load() != nullptr)
+		return;
+	int64_t size = table_size.GetExact();
+	uint32_t capacity = size > current->capacity / 4 ? current->capacity * 2 : current->capacity;
+	OpenAddressingTable* next = new OpenAddressingTable(capacity);
+	OpenAddressingTable* expected = nullptr;
+	if (!current->next.compare_exchange_strong(expected, next))
+		delete next;
+}
+
+/**
+ * @brief Claim the next chunk of slots of a running migration and copy it.
+ *
+ * @param current Table being migrated.
+ * @return true if a chunk was copied
+ * @return false if all chunks have been claimed already
+ */
+bool OpenAddressingHashTable::HelpMigrate(OpenAddressingTable* current) {
+	if (current->migrate_cursor.load() >= current->capacity)
+		return false;
+	uint32_t first = current->migrate_cursor.fetch_add(MIGRATION_CHUNK_SIZE);
+	if (first >= current->capacity)
+		return false;
+	uint32_t last = first + MIGRATION_CHUNK_SIZE < current->capacity ? first + MIGRATION_CHUNK_SIZE : current->capacity;
+	for (uint32_t i = first; i < last; i++)
+		MigrateSlot(current, i);
+	current->migrated.fetch_add(last - first);
+	return true;
+}
+
+/**
+ * @brief Help a migration until every slot has been copied and install the new array.
+ * If helpers that claimed a chunk have not finished it yet, we copy the remaining slots
+ * ourselves instead of waiting, copying a slot twice does no harm.
+ *
+ * @param current Table being migrated.
+ * @return OpenAddressingTable* the table operations should retry in
+ */
+OpenAddressingTable* OpenAddressingHashTable::FinishMigration(OpenAddressingTable* current) {
+	OpenAddressingTable* next = current->next.load();
+	if (next == nullptr)
+		return table.load();
+	while (HelpMigrate(current)) {
+	}
+	if (current->migrated.load() < current->capacity) {
+		for (uint32_t i = 0; i < current->capacity; i++)
+			MigrateSlot(current, i);
+	}
+	OpenAddressingTable* expected = current;
+	if (table.compare_exchange_strong(expected, next))
+		EpochReclamation::Retire(current, &DeleteTable);
+	return table.load();
+}
+
+/**
+ * @brief Freeze a slot, copy its element to the new array if it holds one and mark it as copied.
+ *
+ * @param current Table being migrated.
+ * @param index
+ */
+void OpenAddressingHashTable::MigrateSlot(OpenAddressingTable* current, uint32_t index) {
+	uint64_t word = current->slots[index].fetch_or(FROZEN);
+	if (word & COPIED)
+		return;
+	if ((word & STATE_MASK) == FULL)
+		CopyKey(current->next.load(), (ValueType)(word & KEY_MASK));
+	current->slots[index].fetch_or(COPIED);
+}
+
+/**
+ * @brief Put a key of the old array into the new one. The new array is not used by anybody else
+ * before the migration is done, so finding the key in there (even as a tombstone left by a later
+ * removal) means that another helper copied it already. Neither can a frozen slot show up unless
+ * the migration is long done and the new array is being migrated itself.
+ *
+ * @param target New array.
+ * @param key
+ */
+void OpenAddressingHashTable::CopyKey(OpenAddressingTable* target, ValueType key) {
+	uint32_t mask = target->capacity - 1;
+	uint32_t index = HashFunction(key) & mask;
+	for (uint32_t probes = 0; probes < target->capacity; probes++, index = (index + 1) & mask) {
+		uint64_t word = target->slots[index].load();
+		while (word == EMPTY) {
+			if (target->slots[index].compare_exchange_strong(word, FULL | key)) {
+				target->used.fetch_add(1);
+				return;
+			}
+		}
+		if (word & FROZEN)
+			return;
+		if ((word & KEY_MASK) == key)
+			return;
+	}
+}
+
+/**
+ * @brief Add an element to the hashtable. Claims the first EMPTY slot of the probe sequence
+ * unless the element shows up before. Adding waits for a running migration to finish, so the
+ * old array does not fill up while it is copied.
+ *
+ * @param value Value to be added to the hashtable.
+ * @return true
+ * @return false
+ */
+bool OpenAddressingHashTable::Add(ValueType value) {
+	EpochGuard guard;
+	KeyType hash = HashFunction(value);
+	OpenAddressingTable* current = table.load();
+	while (true) {
+		if (current->next.load() != nullptr) {
+			current = FinishMigration(current);
+			continue;
+		}
+		if (current->used.load(std::memory_order_relaxed) >= current->capacity / 4 * 3) {
+			StartMigration(current);
+			current = FinishMigration(current);
+			continue;
+		}
+		uint32_t mask = current->capacity - 1;
+		uint32_t index = hash & mask;
+		for (uint32_t probes = 0; probes < current->capacity; probes++, index = (index + 1) & mask) {
+			uint64_t word = current->slots[index].load();
+			while (word == EMPTY) {
+				if (current->slots[index].compare_exchange_strong(word, FULL | value)) {
+					current->used.fetch_add(1);
+					table_size.Add(1);
+					return true;
+				}
+			}
+			if (word & FROZEN)
+				break;
+			if ((word & STATE_MASK) == FULL && (word & KEY_MASK) == value)
+				return false;
+		}
+		// ran into a frozen slot, or the slots are used up by concurrent adds
+		StartMigration(current);
+		current = FinishMigration(current);
+	}
+}
+
+/**
+ * @brief Remove an element from the hashtable by turning its slot into a tombstone.
+ * Keeps working on the old array during a migration, after copying a chunk of it.
+ *
+ * @param value Value to be removed from the hashtable.
+ * @return true
+ * @return false
+ */
+bool OpenAddressingHashTable::Remove(ValueType value) {
+	EpochGuard guard;
+	KeyType hash = HashFunction(value);
+	OpenAddressingTable* current = table.load();
+	while (true) {
+		if (current->next.load() != nullptr)
+			HelpMigrate(current);
+		uint32_t mask = current->capacity - 1;
+		uint32_t index = hash & mask;
+		bool frozen = false;
+		for (uint32_t probes = 0; probes < current->capacity; probes++, index = (index + 1) & mask) {
+			uint64_t word = current->slots[index].load();
+			while (word == (FULL | value)) {
+				if (current->slots[index].compare_exchange_strong(word, TOMBSTONE | value)) {
+					table_size.Add(-1);
+					return true;
+				}
+			}
+			if (word & FROZEN) {
+				frozen = true;
+				break;
+			}
+			if (word == EMPTY)
+				return false;
+		}
+		if (!frozen)
+			return false;
+		current = FinishMigration(current);
+	}
+}
+
+/**
+ * @brief Check if an element is in the hashtable. An element in a frozen slot might have been
+ * removed from the new array already, so lookups running into one retry in the new array.
+ *
+ * @param value Value to be checked.
+ * @return true
+ * @return false
+ */
+bool OpenAddressingHashTable::Contains(ValueType value) {
+	EpochGuard guard;
+	KeyType hash = HashFunction(value);
+	OpenAddressingTable* current = table.load();
+	while (true) {
+		if (current->next.load(std::memory_order_relaxed) != nullptr)
+			HelpMigrate(current);
+		uint32_t mask = current->capacity - 1;
+		uint32_t index = hash & mask;
+		bool frozen = false;
+		for (uint32_t probes = 0; probes < current->capacity; probes++, index = (index + 1) & mask) {
+			uint64_t word = current->slots[index].load();
+			if (word & FROZEN) {
+				frozen = true;
+				break;
+			}
+			if (word == EMPTY)
+				return false;
+			if (word == (FULL | value))
+				return true;
+		}
+		if (!frozen)
+			return false;
+		current = FinishMigration(current);
+	}
+}
+
+size_t OpenAddressingHashTable::Size() {
+	int64_t size = table_size.GetExact();
+	return size < 0 ? 0 : (size_t)size;
+}
+
+std::string OpenAddressingHashTable::ToString() {
+	std::stringstream ss;
+	OpenAddressingTable* current = table.load();
+	for (uint32_t i = 0; i < current->capacity; i++) {
+		uint64_t word = current->slots[i].load();
+		if ((word & STATE_MASK) == FULL)
+			ss << "Slot " << i << ": Value " << (word & KEY_MASK) << "\n";
+		else if ((word & STATE_MASK) == TOMBSTONE)
+			ss << "Slot " << i << ": Tombstone\n";
+	}
+	return ss.str();
+}
+
+#endif
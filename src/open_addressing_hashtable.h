@@ -0,0 +1,85 @@
+#ifndef OPEN_ADDRESSING_HASHTABLE_H
+#define OPEN_ADDRESSING_HASHTABLE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include "hash_functions.h"
+#include "lock_free_hashtable.h"
+#include "striped_counter.h"
+
+// A slot packs a 32 bit key and its state into one word, 64 bit keys would need a double width CAS.
+#ifndef SPLIT_ORDER_KEYS_64
+
+/**
+ * One generation of the slot array. Once a resize starts, next points to the array the slots
+ * get migrated to, in chunks claimed through migrate_cursor.
+ */
+struct OpenAddressingTable {
+	const uint32_t capacity;  // power of two
+	std::atomic<uint64_t>* const slots;
+	std::atomic<uint32_t> used;  // slots that are not EMPTY anymore
+	std::atomic<OpenAddressingTable*> next;
+	std::atomic<uint32_t> migrate_cursor;  // first slot no helper has claimed yet
+	std::atomic<uint32_t> migrated;  // slots of claimed chunks that have been copied
+
+	explicit OpenAddressingTable(uint32_t capacity) : capacity(capacity), slots(new std::atomic<uint64_t>[capacity]()), used(0), next(nullptr), migrate_cursor(0), migrated(0) {}
+	~OpenAddressingTable() {
+		delete[] slots;
+	}
+	OpenAddressingTable(const OpenAddressingTable& open_addressing_table) = delete;
+	OpenAddressingTable& operator=(const OpenAddressingTable& a) = delete;
+};
+
+/**
+ * Lock-free hashtable with open addressing: one flat array of slots probed linearly, so a
+ * lookup usually costs a single cache line instead of a walk over list nodes. Adding claims the
+ * first EMPTY slot of the probe sequence with one CAS, removing turns the slot into a tombstone
+ * that keeps the key. Tombstones are never reused, so two threads adding the same key always
+ * race for the same slot; they disappear when the table migrates.
+ * Once three quarters of the slots are used, the slots are migrated into a new array, twice as
+ * large unless most of them are tombstones. Every operation that notices the migration copies a
+ * chunk of slots, a slot is frozen before it gets copied, and an operation that runs into a frozen
+ * slot finishes the migration and retries in the new array. Old arrays are reclaimed with epochs.
+ * Only available with 32 bit keys.
+ */
+class OpenAddressingHashTable : public HashTable {
+   private:
+	static const uint32_t INITIAL_CAPACITY = 64;
+	static const uint32_t MIGRATION_CHUNK_SIZE = 256;  // slots a helper copies at once
+	static const uint64_t EMPTY = 0;
+	static const uint64_t KEY_MASK = 0xFFFFFFFF;
+	static const uint64_t FULL = 1ull << 32;
+	static const uint64_t TOMBSTONE = 2ull << 32;
+	static const uint64_t STATE_MASK = 3ull << 32;
+	static const uint64_t FROZEN = 1ull << 34;  // the slot is being migrated and does not change anymore
+	static const uint64_t COPIED = 1ull << 35;  // the slot has been migrated
+	const HashKind hash_kind;
+	const uint64_t seed;
+	std::atomic<OpenAddressingTable*> table;
+	StripedCounter table_size;  // number of elements in the table
+	KeyType HashFunction(ValueType value);
+	void StartMigration(OpenAddressingTable* current);
+	bool HelpMigrate(OpenAddressingTable* current);
+	OpenAddressingTable* FinishMigration(OpenAddressingTable* current);
+	void MigrateSlot(OpenAddressingTable* current, uint32_t index);
+	void CopyKey(OpenAddressingTable* target, ValueType key);
+	static void DeleteTable(void* table);
+
+   public:
+	explicit OpenAddressingHashTable(HashKind hash_kind = HashKind::MIXER, uint64_t seed = RandomSeed());
+	OpenAddressingHashTable(const OpenAddressingHashTable& open_addressing_hashtable) = delete;
+	OpenAddressingHashTable& operator=(const OpenAddressingHashTable& a) = delete;
+	~OpenAddressingHashTable() override;
+	bool Add(ValueType value) override;
+	bool Remove(ValueType value) override;
+	bool Contains(ValueType value) override;
+	size_t Size() override;
+	std::string ToString() override;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * @file radix_sort.cpp
+ * @author Josef Salzmann &	Aleksandar Hadzhiyski
+ * @brief Parallel radix sort of split-order items, used to build whole lists at once.
+ * @date 2026-10-15
+ */
+#include "radix_sort.h"
+
+#include <omp.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+static const uint32_t RADIX_BITS = 8;
+static const uint32_t RADIX = 1 << RADIX_BITS;
+
+/**
+ * @brief Sort items into list order, by key and then by value. A least significant digit
+ * radix sort on the keys: in every pass each thread counts the digits of its share of the
+ * items, the counts are turned into the positions of every thread and digit, and each thread
+ * scatters its items there. Passes whose digit is the same for all items are skipped.
+ * Equal keys are rare, their runs are sorted by value afterwards.
+ *
+ * @param items
+ * @param buffer Scratch space for count items.
+ * @param count
+ * @param n_threads
+ */
+void RadixSort(KeyValue* items, KeyValue* buffer, size_t count, int n_threads) {
+	if (count < 2)
+		return;
+	std::vector<size_t> offsets((size_t)n_threads * RADIX);
+	KeyValue* from = items;
+	KeyValue* to = buffer;
+
+	for (uint32_t shift = 0; shift < sizeof(KeyType) * 8; shift += RADIX_BITS) {
+		bool skip = false;
+#pragma omp parallel num_threads(n_threads)
+		{
+			int t = omp_get_thread_num();
+			int nt = omp_get_num_threads();
+			size_t lo = count * t / nt;
+			size_t hi = count * (t + 1) / nt;
+			size_t* local = &offsets[(size_t)t * RADIX];
+			memset(local, 0, RADIX * sizeof(size_t));
+			for (size_t i = lo; i < hi; i++)
+				local[(from[i].key >> shift) & (RADIX - 1)]++;
+#pragma omp barrier
+#pragma omp single
+			{
+				size_t first_digit = (from[0].key >> shift) & (RADIX - 1);
+				size_t first_digit_count = 0;
+				for (int u = 0; u < nt; u++)
+					first_digit_count += offsets[(size_t)u * RADIX + first_digit];
+				skip = first_digit_count == count;
+				size_t sum = 0;
+				for (uint32_t digit = 0; digit < RADIX; digit++) {
+					for (int u = 0; u < nt; u++) {
+						size_t digit_count = offsets[(size_t)u * RADIX + digit];
+						offsets[(size_t)u * RADIX + digit] = sum;
+						sum += digit_count;
+					}
+				}
+			}
+			if (!skip) {
+				for (size_t i = lo; i < hi; i++)
+					to[local[(from[i].key >> shift) & (RADIX - 1)]++] = from[i];
+			}
+		}
+		if (!skip)
+			std::swap(from, to);
+	}
+
+	if (from != items) {
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+		for (size_t i = 0; i < count; i++)
+			items[i] = from[i];
+	}
+
+#pragma omp parallel for num_threads(n_threads) schedule(static)
+	for (size_t i = 0; i < count; i++) {
+		if (i > 0 && items[i - 1].key == items[i].key)
+			continue;
+		size_t end = i + 1;
+		while (end < count && items[end].key == items[i].key)
+			end++;
+		if (end - i > 1)
+			std::sort(items + i, items + end);
+	}
+}
@@ -0,0 +1,10 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <stddef.h>
+
+#include "lock_free_list.h"
+
+void RadixSort(KeyValue* items, KeyValue* buffer, size_t count, int n_threads);
+
+#endif
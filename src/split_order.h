@@ -0,0 +1,33 @@
+#ifndef SPLIT_ORDER_H
+#define SPLIT_ORDER_H
+
+#include <stdint.h>
+
+/**
+ * Bit tricks shared by the split-ordered hashtables. Instead of looping over all bits we
+ * swap neighbouring bits, pairs and nibbles and let a byte swap do the rest.
+ */
+inline uint32_t ReverseBits(uint32_t x) {
+	x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+	x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+	x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+	return __builtin_bswap32(x);
+}
+
+inline uint64_t ReverseBits(uint64_t x) {
+	x = ((x >> 1) & 0x5555555555555555) | ((x & 0x5555555555555555) << 1);
+	x = ((x >> 2) & 0x3333333333333333) | ((x & 0x3333333333333333) << 2);
+	x = ((x >> 4) & 0x0F0F0F0F0F0F0F0F) | ((x & 0x0F0F0F0F0F0F0F0F) << 4);
+	return __builtin_bswap64(x);
+}
+
+/**
+ * @brief Parent of a bucket, i.e. the bucket with the most significant bit cleared.
+ * The sentinel node of the parent comes before the one of the bucket in the list.
+ * Bucket 0 has no parent.
+ */
+inline uint32_t GetParentBucket(uint32_t bucket) {
+	return bucket & ~(0x80000000u >> __builtin_clz(bucket));
+}
+
+#endif
@@ -0,0 +1,990 @@
+#ifndef SPLIT_ORDERED_HASHTABLE_H
+#define SPLIT_ORDERED_HASHTABLE_H
+
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "batch_kernels.h"
+#include "bucket_directory.h"
+#include "epoch_reclamation.h"
+#include "hash_functions.h"
+#include "lock_free_list.h"
+#include "node_pool.h"
+#include "radix_sort.h"
+#include "split_order.h"
+#include "striped_counter.h"
+
+/**
+ * Hash policy of SplitOrderedHashTable: HashValue() with the hash function fixed at compile
+ * time, so the switch over the hash kinds folds away.
+ */
+template <HashKind KIND>
+struct SeededHash {
+	uint64_t seed;
+
+	explicit SeededHash(uint64_t seed = RandomSeed()) : seed(seed) {}
+
+	KeyType operator()(ValueType value) const {
+		return HashValue(KIND, seed, value);
+	}
+
+	HashKind GetKind() const {
+		return KIND;
+	}
+
+	uint64_t GetSeed() const {
+		return seed;
+	}
+};
+
+/**
+ * Hash policy with the hash function picked at runtime, for LockFreeHashTable.
+ */
+struct RuntimeHash {
+	HashKind kind;
+	uint64_t seed;
+
+	explicit RuntimeHash(HashKind kind = HashKind::MIXER, uint64_t seed = RandomSeed()) : kind(kind), seed(seed) {}
+
+	KeyType operator()(ValueType value) const {
+		return HashValue(kind, seed, value);
+	}
+
+	HashKind GetKind() const {
+		return kind;
+	}
+
+	uint64_t GetSeed() const {
+		return seed;
+	}
+};
+
+/**
+ * Allocator policies of SplitOrderedHashTable, for the nodes of the list.
+ */
+struct PoolAllocator {
+	static NodeType* Allocate() {
+		return NodePool::Allocate();
+	}
+
+	static void Free(NodeType* node) {
+		NodePool::Free(node);
+	}
+
+	static void Delete(void* node) {
+		NodePool::FreeDeleter(node);
+	}
+};
+
+struct HeapAllocator {
+	static NodeType* Allocate() {
+		return new NodeType;
+	}
+
+	static void Free(NodeType* node) {
+		delete node;
+	}
+
+	static void Delete(void* node) {
+		delete static_cast<NodeType*>(node);
+	}
+};
+
+enum class BatchStage {
+	SENTINEL,  // directory entry prefetched, next we load the sentinel node
+	START,     // sentinel node prefetched, next we begin the traversal
+	WALK       // next node of the traversal prefetched
+};
+
+/**
+ * State of one lookup of ContainsBatch() in flight.
+ */
+struct BatchLookup {
+	size_t index;  // position in the batch
+	KeyValue item;
+	uint32_t bucket;
+	NodeType* node;
+	BatchStage stage;
+};
+
+/**
+ * Header of a snapshot file, followed by count items in list order. Sizes of keys and items
+ * keep snapshots of a build with 32 bit keys from being loaded by one with 64 bit keys.
+ */
+struct SnapshotHeader {
+	uint64_t magic;
+	uint32_t key_size;
+	uint32_t item_size;
+	uint32_t hash_kind;
+	uint32_t mask;  // bucket mask of the directory
+	uint64_t seed;
+	uint64_t count;  // number of elements
+};
+
+const uint64_t SNAPSHOT_MAGIC = 0x31544f4853504e53;  // "SNPSHOT1"
+
+/**
+ * Sentinel node that got unlinked by shrinking, with the global epoch right afterwards.
+ */
+struct UnlinkedSentinel {
+	NodeType* node;
+	uint64_t epoch;
+};
+
+/**
+ * Lock free hashtable based on
+ * Ori Shalev, Nir Shavit: Split-ordered lists: Lock-free extensible hash tables. J. ACM 53(3): 379-405 (2006)
+ * as a header-only template, with the hash function, the reclamation scheme, the node allocator and
+ * the load factor (the average number of elements per bucket before the directory doubles, as a
+ * std::integral_constant) given as policies. All of them are known at compile time, so the hot path
+ * inlines into the caller without virtual calls or branches on runtime settings.
+ * LockFreeHashTable maps the runtime options onto these policies, wrap it into HashTableAdapter
+ * where a HashTable with fixed policies is needed.
+ */
+template <typename Hash = SeededHash<HashKind::MIXER>, typename Reclaimer = EpochReclaimer, typename Allocator = PoolAllocator, typename LoadFactor = std::integral_constant<uint32_t, 4>>
+class SplitOrderedHashTable {
+   private:
+	LockFreeList<Reclaimer, Allocator> list;
+	Hash hash;
+	BucketDirectory<NodeType> hashtable;
+	static constexpr uint32_t MAX_AVERAGE_BUCKET_SIZE = LoadFactor::value;  // if table_size > MAX_AVERAGE_BUCKET_SIZE * size(hashtable) then we double the number of hashtable entries
+	static constexpr uint32_t SHRINK_FACTOR = 4;  // if table_size < MAX_AVERAGE_BUCKET_SIZE / SHRINK_FACTOR * size(hashtable) then we halve the number of hashtable entries
+	static constexpr KeyType HIGH = (KeyType)1 << (sizeof(KeyType) * 8 - 1);
+#ifdef SPLIT_ORDER_KEYS_64
+	static constexpr KeyType MASK = 0x7FFFFFFFFFFFFFFF;  // hash bits that make it into the split-order key
+	static constexpr uint32_t MAX_BUCKET_MASK = 0x7FFFFFFF;  // keeps the number of buckets in 32 bits, still 2^31 buckets
+#else
+	static constexpr KeyType MASK = 0x00FFFFFF;
+	static constexpr uint32_t MAX_BUCKET_MASK = 0x00FFFFFF;
+#endif
+	static constexpr uint32_t RESIZE_CHUNK_SIZE = 64;  // buckets a thread initializes at once when helping with a resize
+	static constexpr uint32_t BATCH_GROUP_SIZE = 16;  // operations of a batch that are in flight at once
+	static constexpr uint32_t BATCH_KEY_BLOCK_SIZE = 256;  // values of a batch whose keys get prepared at once
+	static constexpr uint32_t RANGES_PER_THREAD = 8;  // ParallelForEach() splits the list into this many ranges per thread
+	static constexpr size_t SNAPSHOT_BUFFER_SIZE = 4096;  // items SaveSnapshot() writes at once
+	StripedCounter table_size;  // number of elements in the table without sentinel nodes
+	std::atomic<uint32_t> resize_cursor;  // every bucket below has been initialized or claimed by a helping thread
+	std::atomic<bool> shrinking;  // set while one thread halves the table
+	std::atomic<uint32_t> reserved_mask;  // the directory never shrinks below this mask, see Reserve()
+	std::vector<UnlinkedSentinel> unlinked_sentinels;  // not retired yet in the order they got unlinked, only touched by the shrinking thread
+
+	/**
+	 * @brief Hash a value with the hash policy of this table. Every operation hashes
+	 * its value once and derives both the bucket and the split-order key from the result.
+	 */
+	KeyType HashFunction(ValueType value) {
+		return hash(value);
+	}
+
+	/**
+	 * @brief Make a normal key for a normal (i.e. not sentinel) value.
+	 * The key is basically the reversed masked hash with its LSB set to one.
+	 * This ensures that we are always bigger than the respective sentinel node.
+	 */
+	static KeyType MakeNormalKey(KeyType hash_value) {
+		return ReverseBits((hash_value & MASK) | HIGH);
+	}
+
+	/**
+	 * @brief Make a sentinel key. The lowest bit of the key is never set.
+	 */
+	static KeyType MakeSentinelKey(uint32_t bucket) {
+		return ReverseBits((KeyType)bucket & MASK);
+	}
+
+	/**
+	 * @brief Return the sentinel node for a given hash. If the bucket has not been used so far
+	 * we initialize it first.
+	 */
+	NodeType* GetSentinelNode(KeyType hash_value) {
+		return GetBucketSentinel((uint32_t)hash_value & hashtable.GetMask());
+	}
+
+	/**
+	 * @brief Return the sentinel node of a bucket, initializing the bucket if necessary.
+	 * A thread that found a sentinel node before the table shrank might have stored it after it
+	 * got unlinked, such entries are cleared and the bucket gets initialized again.
+	 *
+	 * @param bucket
+	 * @return NodeType*
+	 */
+	NodeType* GetBucketSentinel(uint32_t bucket) {
+		NodeType* sentinel = hashtable.Load(bucket);
+		if (sentinel != nullptr && list.GetFlag(sentinel->next)) {
+			hashtable.CompareAndStore(bucket, sentinel, nullptr);
+			sentinel = nullptr;
+		}
+		if (sentinel == nullptr)
+			sentinel = InitializeBucket(bucket);
+		return sentinel;
+	}
+
+	/**
+	 * @brief Lazily add the sentinel node of a bucket, as in the paper. The parent bucket
+	 * is initialized recursively if necessary. Several threads might initialize the same
+	 * bucket concurrently, but only one sentinel node makes it into the list and all of
+	 * them end up with a pointer to that one.
+	 *
+	 * @param bucket Bucket to initialize, has to be smaller than the size of the hashtable.
+	 * @return NodeType* the sentinel node of bucket
+	 */
+	NodeType* InitializeBucket(uint32_t bucket) {
+		NodeType* start = GetBucketSentinel(GetParentBucket(bucket));
+		NodeType* sentinel = list.AddAndGetPointer(start, {MakeSentinelKey(bucket), bucket});
+		hashtable.Store(bucket, sentinel);
+		// a shrink might have removed the sentinel node since we found it, then it must not stay
+		// in the directory, see RetireUnlinkedSentinels()
+		if (list.GetFlag(sentinel->next))
+			hashtable.CompareAndStore(bucket, sentinel, nullptr);
+		return sentinel;
+	}
+
+	/**
+	 * @brief Cooperative part of resizing. After the directory has been doubled, writers that
+	 * notice uninitialized new buckets claim a chunk of RESIZE_CHUNK_SIZE of them and insert
+	 * their sentinel nodes, so the sentinels of a resize get inserted by all writing threads
+	 * in parallel instead of lazily one at a time. Each call handles at most one chunk.
+	 */
+	void HelpResize() {
+		uint32_t number_of_buckets = hashtable.GetNumberOfBuckets();
+		uint32_t first = resize_cursor.load();
+		while (first < number_of_buckets) {
+			uint32_t last = std::min(first + RESIZE_CHUNK_SIZE, number_of_buckets);
+			if (!resize_cursor.compare_exchange_weak(first, last))
+				continue;
+			for (uint32_t bucket = first; bucket < last; bucket++) {
+				GetBucketSentinel(bucket);
+			}
+			return;
+		}
+	}
+
+	/**
+	 * @brief Halve the directory after the table got drained. Only one thread shrinks at a time,
+	 * the others just carry on. The sentinel nodes of the upper half get removed from the list and
+	 * their directory entries cleared, threads with an outdated bucket mask find them marked and
+	 * start from the head instead. Once the directory is cleared its upper segment gets retired.
+	 * If the table grows again while we are at it, we stop and keep the remaining sentinels.
+	 * Without reclamation the sentinel nodes and segments are leaked like any other node.
+	 *
+	 * @param mask The bucket mask the caller based its decision on.
+	 */
+	void HalveHashTableSize(uint32_t mask) {
+		bool expected = false;
+		if (!shrinking.compare_exchange_strong(expected, true))
+			return;
+		if constexpr (Reclaimer::RECLAIMS)
+			RetireUnlinkedSentinels();
+		uint32_t new_mask = mask >> 1;
+		if (hashtable.Shrink(mask)) {
+			uint32_t cursor = resize_cursor.load();
+			while (cursor > new_mask + 1 && !resize_cursor.compare_exchange_weak(cursor, new_mask + 1)) {
+			}
+			for (uint32_t bucket = mask; bucket > new_mask && hashtable.GetMask() == new_mask; bucket--) {
+				NodeType* sentinel = hashtable.Load(bucket);
+				if (sentinel == nullptr || list.GetFlag(sentinel->next))
+					continue;
+				if (!hashtable.CompareAndStore(bucket, sentinel, nullptr))
+					continue;
+				NodeType* start = GetBucketSentinel(GetParentBucket(bucket));
+				if (!list.Remove(start, sentinel->item))
+					continue;
+				// a thread that found the sentinel node before we marked it might have stored it again
+				hashtable.CompareAndStore(bucket, sentinel, nullptr);
+				if constexpr (Reclaimer::RECLAIMS)
+					unlinked_sentinels.push_back({sentinel, EpochReclamation::GetEpoch()});
+			}
+			if constexpr (Reclaimer::RECLAIMS) {
+				if (hashtable.GetMask() == new_mask) {
+					std::atomic<NodeType*>* segment = hashtable.DetachSegment(new_mask);
+					if (segment != nullptr)
+						EpochReclamation::Retire(segment, &BucketDirectory<NodeType>::DeleteSegment);
+				}
+			}
+		}
+		shrinking.store(false);
+	}
+
+	/**
+	 * @brief Retire the sentinel nodes unlinked by earlier shrinks, once every thread that was inside
+	 * a critical section back then has left it. Such a thread might have found one of them before it
+	 * got marked and stored it in the directory afterwards, until it notices the mark and clears the
+	 * entry again. Threads that load the node from the directory in between are not covered by the
+	 * epoch we would retire it in, but they are once we wait for the stale ones first.
+	 * Called by the shrinking thread, which tries to advance the epoch, since with hazard pointers
+	 * nobody else might. Sentinel nodes of a shrink are then retired two shrinks later.
+	 */
+	void RetireUnlinkedSentinels() {
+		if (unlinked_sentinels.empty())
+			return;
+		EpochReclamation::TryAdvance();
+		uint64_t epoch = EpochReclamation::GetEpoch();
+		size_t retired = 0;
+		for (; retired < unlinked_sentinels.size() && unlinked_sentinels[retired].epoch + 2 <= epoch; retired++)
+			EpochReclamation::Retire(unlinked_sentinels[retired].node, &Allocator::Delete);
+		unlinked_sentinels.erase(unlinked_sentinels.begin(), unlinked_sentinels.begin() + retired);
+	}
+
+	/**
+	 * @brief Smallest bucket mask at which expected_size elements do not trigger a doubling.
+	 */
+	static uint32_t GetMaskForSize(size_t expected_size) {
+		uint32_t mask = 1;
+		while ((uint64_t)expected_size > (uint64_t)MAX_AVERAGE_BUCKET_SIZE * (mask + 1) && mask < MAX_BUCKET_MASK)
+			mask = (mask << 1) | 1;
+		return mask;
+	}
+
+	/**
+	 * @brief Unlink and free everything between head and tail of a table without elements, i.e.
+	 * sentinel nodes and deleted nodes still linked, and grow the directory to the given mask.
+	 * No other thread may use the table meanwhile.
+	 *
+	 * @param mask At least the current mask.
+	 * @return NodeType* the tail of the list
+	 */
+	NodeType* ClearList(uint32_t mask) {
+		NodeType* current = static_cast<NodeType*>(list.GetPointer(list.GetHead()->next));
+		while (current->next.load() != nullptr) {
+			NodeType* next = static_cast<NodeType*>(list.GetPointer(current->next));
+			if ((current->item.key & 1) == 0 && hashtable.Load((uint32_t)current->item.value) == current)
+				hashtable.Store((uint32_t)current->item.value, nullptr);
+			Allocator::Free(current);
+			current = next;
+		}
+		for (uint32_t current_mask = hashtable.GetMask(); current_mask < mask; current_mask = (current_mask << 1) | 1)
+			hashtable.Grow(current_mask);
+		return current;
+	}
+
+	/**
+	 * @brief Replace the list of a table without elements by one holding the given values, with the
+	 * directory grown to the given mask. Sentinel nodes and deleted nodes still linked are freed. The
+	 * split-order keys of the values and of all sentinel nodes are prepared in parallel, radix sorted
+	 * into list order, and every thread links the nodes of its share of the sorted items. The shares
+	 * are then chained and the sentinel nodes stored in the directory, so no bucket needs lazy
+	 * initialization afterwards. No other thread may use the table meanwhile.
+	 *
+	 * @param values
+	 * @param count
+	 * @param mask At least the current mask.
+	 * @param n_threads
+	 * @return size_t Number of distinct values that got added.
+	 */
+	size_t BuildList(const ValueType* values, size_t count, uint32_t mask, int n_threads) {
+		NodeType* head = list.GetHead();
+		NodeType* tail = ClearList(mask);
+
+		// one item per value and one per sentinel node, bucket 0 has the head of the list
+		size_t number_of_items = count + mask;
+		std::unique_ptr<KeyValue[]> items(new KeyValue[number_of_items]);
+		std::unique_ptr<KeyValue[]> buffer(new KeyValue[number_of_items]);
+#pragma omp parallel num_threads(n_threads)
+		{
+			KeyType hashes[BATCH_KEY_BLOCK_SIZE];
+			KeyType keys[BATCH_KEY_BLOCK_SIZE];
+#pragma omp for schedule(static)
+			for (size_t first = 0; first < count; first += BATCH_KEY_BLOCK_SIZE) {
+				size_t block = std::min(count - first, (size_t)BATCH_KEY_BLOCK_SIZE);
+				PrepareKeys(hash.GetKind(), hash.GetSeed(), values + first, block, MASK, hashes, keys);
+				for (size_t i = 0; i < block; i++)
+					items[first + i] = {keys[i], values[first + i]};
+			}
+#pragma omp for schedule(static)
+			for (uint32_t bucket = 1; bucket <= mask; bucket++)
+				items[count + bucket - 1] = {MakeSentinelKey(bucket), bucket};
+		}
+		RadixSort(items.get(), buffer.get(), number_of_items, n_threads);
+		buffer.reset();
+
+		std::vector<NodeType*> firsts(n_threads, nullptr);
+		std::vector<NodeType*> lasts(n_threads, nullptr);
+		size_t added = 0;
+#pragma omp parallel num_threads(n_threads) reduction(+ : added)
+		{
+			int t = omp_get_thread_num();
+			int nt = omp_get_num_threads();
+			size_t lo = number_of_items * t / nt;
+			size_t hi = number_of_items * (t + 1) / nt;
+			NodeType* last = nullptr;
+			for (size_t i = lo; i < hi; i++) {
+				if (i > 0 && items[i] == items[i - 1])
+					continue;
+				NodeType* node = Allocator::Allocate();
+				node->item = items[i];
+				if (last == nullptr)
+					firsts[t] = node;
+				else
+					last->next.store(node, std::memory_order_relaxed);
+				last = node;
+				if (items[i].key & 1)
+					added++;
+				else
+					hashtable.Store((uint32_t)items[i].value, node);
+			}
+			lasts[t] = last;
+		}
+
+		NodeType* pred = head;
+		for (int t = 0; t < n_threads; t++) {
+			if (firsts[t] == nullptr)
+				continue;
+			pred->next.store(firsts[t]);
+			pred = lasts[t];
+		}
+		pred->next.store(tail);
+		table_size.Add((int64_t)added);
+		resize_cursor.store(mask + 1);
+		return added;
+	}
+
+	/**
+	 * @brief Add() for a value that has already been hashed, without helping to resize.
+	 * Has to be called while holding a Guard.
+	 *
+	 * @param value
+	 * @param hash_value HashFunction(value)
+	 * @param key MakeNormalKey(hash_value)
+	 * @return true
+	 * @return false
+	 */
+	bool AddHashed(ValueType value, KeyType hash_value, KeyType key) {
+		NodeType* sentinel = GetSentinelNode(hash_value);
+		bool success = list.Add(sentinel, {key, value});
+		if (!success) {
+			return false;
+		} else {
+			table_size.Add(1);  // the approximate count lags behind a bit,
+			    // but that should not be a problem since the resize regime is not that strict.
+			uint32_t mask = hashtable.GetMask();
+			int64_t permissibletablesize = (int64_t)MAX_AVERAGE_BUCKET_SIZE * (mask + 1);
+			if (table_size.GetApproximate() > permissibletablesize && mask < MAX_BUCKET_MASK) {
+				hashtable.Grow(mask);  // if the CAS fails someone else already doubled the table
+			}
+
+			return true;
+		}
+	}
+
+	/**
+	 * @brief Remove() for a value that has already been hashed, without helping to resize.
+	 * Has to be called while holding a Guard.
+	 *
+	 * @param value
+	 * @param hash_value HashFunction(value)
+	 * @param key MakeNormalKey(hash_value)
+	 * @return true
+	 * @return false
+	 */
+	bool RemoveHashed(ValueType value, KeyType hash_value, KeyType key) {
+		NodeType* sentinel = GetSentinelNode(hash_value);
+		bool success = list.Remove(sentinel, {key, value});
+		if (!success) {
+			return false;
+		} else {
+			table_size.Add(-1);  // the approximate count lags behind a bit, but that should not be a problem since the resize regime is not that strict.
+			uint32_t mask = hashtable.GetMask();
+			if (mask > reserved_mask.load(std::memory_order_relaxed) && table_size.GetApproximate() * SHRINK_FACTOR < (int64_t)MAX_AVERAGE_BUCKET_SIZE * (mask + 1)) {
+				HalveHashTableSize(mask);
+			}
+			return true;
+		}
+	}
+
+	/**
+	 * @brief Prefetch the directory entry of a hashed value and put its lookup into the first stage.
+	 */
+	void StartLookup(BatchLookup* lookup, size_t index, ValueType value, KeyType hash_value, KeyType key) {
+		lookup->index = index;
+		lookup->item = {key, value};
+		lookup->bucket = (uint32_t)hash_value & hashtable.GetMask();
+		lookup->node = nullptr;
+		lookup->stage = BatchStage::SENTINEL;
+		hashtable.Prefetch(lookup->bucket);
+	}
+
+	/**
+	 * @brief Prepare the keys of a group of values and prefetch their directory entries, then their
+	 * sentinel nodes, so the operations on the group find them in the cache.
+	 *
+	 * @param values
+	 * @param count At most BATCH_GROUP_SIZE
+	 * @param hashes Receives the hashes of the values.
+	 * @param keys Receives the normal keys of the values.
+	 */
+	void PrefetchGroup(const ValueType* values, uint32_t count, KeyType* hashes, KeyType* keys) {
+		uint32_t mask = hashtable.GetMask();
+		PrepareKeys(hash.GetKind(), hash.GetSeed(), values, count, MASK, hashes, keys);
+		for (uint32_t i = 0; i < count; i++)
+			hashtable.Prefetch((uint32_t)hashes[i] & mask);
+		for (uint32_t i = 0; i < count; i++) {
+			NodeType* sentinel = hashtable.Load((uint32_t)hashes[i] & mask);
+			if (sentinel != nullptr)
+				__builtin_prefetch(sentinel);
+		}
+	}
+
+   public:
+	/**
+	 * @brief Construct a new table. Initializing the underlying list yields one head node with
+	 * value 0 and one tail node with the largest key. The head node is the sentinel node of
+	 * bucket 0, the sentinel node of bucket 1 gets added once the bucket is first used.
+	 * The tail node of the list will be never accessed.
+	 * Seeded hash policies like SeededHash get a fresh seed per table unless one is passed in.
+	 *
+	 * @param hash
+	 */
+	explicit SplitOrderedHashTable(const Hash& hash = Hash()) : hash(hash), hashtable(2) {
+		hashtable.Store(0, list.GetHead());
+
+		resize_cursor.store(1);
+		shrinking.store(false);
+		reserved_mask.store(1);
+	}
+
+	/**
+	 * @brief Free the sentinel nodes unlinked by shrinking that have not been retired yet, the list
+	 * frees the linked nodes. Only safe once no other thread accesses the table.
+	 */
+	~SplitOrderedHashTable() {
+		for (UnlinkedSentinel sentinel : unlinked_sentinels)
+			Allocator::Free(sentinel.node);
+	}
+
+	SplitOrderedHashTable(const SplitOrderedHashTable& split_ordered_hashtable) = delete;
+	SplitOrderedHashTable& operator=(const SplitOrderedHashTable& a) = delete;
+
+	/**
+	 * @brief Add an element to the hashtable.
+	 * If the approximate tablesize is bigger MAX_AVERAGE_BUCKET_SIZE * size(hashtable) we double the size of the table,
+	 * which just means doubling the bucket mask of the directory. The new sentinel nodes are inserted
+	 * by the writers through HelpResize() or by whoever first touches a bucket.
+	 *
+	 * @param value Value to be added to the hashtable.
+	 * @return true
+	 * @return false
+	 */
+	bool Add(ValueType value) {
+		typename Reclaimer::Guard guard;
+		if (resize_cursor.load(std::memory_order_relaxed) <= hashtable.GetMask())
+			HelpResize();
+		KeyType hash_value = HashFunction(value);
+		return AddHashed(value, hash_value, MakeNormalKey(hash_value));
+	}
+
+	/**
+	 * @brief Remove an element from the hashtable.
+	 * If the average bucket holds less than MAX_AVERAGE_BUCKET_SIZE / SHRINK_FACTOR elements we
+	 * halve the table. That leaves a factor of two in between, so a table does not keep growing
+	 * and shrinking around one size.
+	 *
+	 * @param value The value to be removed.
+	 * @return true
+	 * @return false
+	 */
+	bool Remove(ValueType value) {
+		typename Reclaimer::Guard guard;
+		if (resize_cursor.load(std::memory_order_relaxed) <= hashtable.GetMask())
+			HelpResize();
+		KeyType hash_value = HashFunction(value);
+		return RemoveHashed(value, hash_value, MakeNormalKey(hash_value));
+	}
+
+	/**
+	 * @brief Check if a value is contained in the hashtable.
+	 *
+	 * @param value Value for which we check.
+	 * @return true
+	 * @return false
+	 */
+	bool Contains(ValueType value) {
+		typename Reclaimer::Guard guard;
+		KeyType hash_value = HashFunction(value);
+		NodeType* sentinel = GetSentinelNode(hash_value);
+		return list.Contains(sentinel, {MakeNormalKey(hash_value), value});
+	}
+
+	/**
+	 * @brief Look up a batch of values. Instead of stalling on every cache miss of one traversal
+	 * after another, up to BATCH_GROUP_SIZE lookups are in flight at once (asynchronous memory access
+	 * chaining): each lookup prefetches the next thing it needs, its directory entry, its sentinel
+	 * node or the next node of its chain, and hands over to the next lookup. By the time we come
+	 * back to it the memory has hopefully arrived. Finished lookups are replaced by the next value.
+	 * The keys are prepared with the vector kernels, BATCH_KEY_BLOCK_SIZE values at a time.
+	 * With hazard pointers every step would need a protected load, so we just loop there.
+	 *
+	 * @param values
+	 * @param count
+	 * @param results Bitmap with (count + 63) / 64 words, bit i tells whether values[i] is contained.
+	 */
+	void ContainsBatch(const ValueType* values, size_t count, uint64_t* results) {
+		memset(results, 0, (count + 63) / 64 * sizeof(uint64_t));
+		if constexpr (Reclaimer::PROTECTS) {
+			for (size_t i = 0; i < count; i++)
+				results[i / 64] |= (uint64_t)Contains(values[i]) << (i % 64);
+			return;
+		}
+		typename Reclaimer::Guard guard;
+		BatchLookup lookups[BATCH_GROUP_SIZE];
+		KeyType hashes[BATCH_KEY_BLOCK_SIZE];
+		KeyType keys[BATCH_KEY_BLOCK_SIZE];
+		size_t block_start = 0;
+		size_t block_end = 0;
+		size_t next = 0;
+		auto StartNext = [&](BatchLookup* lookup) {
+			if (next == block_end) {
+				block_start = next;
+				block_end = std::min(count, block_start + BATCH_KEY_BLOCK_SIZE);
+				PrepareKeys(hash.GetKind(), hash.GetSeed(), values + block_start, block_end - block_start, MASK, hashes, keys);
+			}
+			StartLookup(lookup, next, values[next], hashes[next - block_start], keys[next - block_start]);
+			next++;
+		};
+		uint32_t active = 0;
+		while (active < BATCH_GROUP_SIZE && next < count)
+			StartNext(&lookups[active++]);
+
+		while (active > 0) {
+			for (uint32_t i = 0; i < active;) {
+				BatchLookup* lookup = &lookups[i];
+				NodeType* node = lookup->node;
+				switch (lookup->stage) {
+				case BatchStage::SENTINEL:
+					node = hashtable.Load(lookup->bucket);
+					if (node == nullptr)
+						node = GetBucketSentinel(lookup->bucket);
+					__builtin_prefetch(node);
+					lookup->node = node;
+					lookup->stage = BatchStage::START;
+					i++;
+					continue;
+				case BatchStage::START:
+					node = list.GetStart(node, node);
+					lookup->stage = BatchStage::WALK;
+					// fall through, the first node is in the cache already
+				case BatchStage::WALK:
+					if (node != nullptr && node->item < lookup->item) {
+						node = static_cast<NodeType*>(list.GetPointer(node->next));
+						__builtin_prefetch(node);
+						lookup->node = node;
+						i++;
+						continue;
+					}
+				}
+
+				bool found = node != nullptr && node->item == lookup->item && !list.GetFlag(node->next);
+				results[lookup->index / 64] |= (uint64_t)found << (lookup->index % 64);
+				if (next < count) {
+					StartNext(lookup);
+					i++;
+				} else {
+					*lookup = lookups[--active];
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Add a batch of values. The writes themselves stay one after another, but every group
+	 * of BATCH_GROUP_SIZE values is hashed up front and gets its directory entries and sentinel
+	 * nodes prefetched, so those misses overlap.
+	 *
+	 * @param values
+	 * @param count
+	 * @param results Bitmap with (count + 63) / 64 words, bit i tells whether values[i] got added.
+	 */
+	void AddBatch(const ValueType* values, size_t count, uint64_t* results) {
+		memset(results, 0, (count + 63) / 64 * sizeof(uint64_t));
+		typename Reclaimer::Guard guard;
+		KeyType hashes[BATCH_GROUP_SIZE];
+		KeyType keys[BATCH_GROUP_SIZE];
+		for (size_t first = 0; first < count; first += BATCH_GROUP_SIZE) {
+			uint32_t group = (uint32_t)std::min((size_t)BATCH_GROUP_SIZE, count - first);
+			if (resize_cursor.load(std::memory_order_relaxed) <= hashtable.GetMask())
+				HelpResize();
+			PrefetchGroup(values + first, group, hashes, keys);
+			for (uint32_t i = 0; i < group; i++) {
+				size_t index = first + i;
+				results[index / 64] |= (uint64_t)AddHashed(values[index], hashes[i], keys[i]) << (index % 64);
+			}
+		}
+	}
+
+	/**
+	 * @brief Remove a batch of values, prefetching like AddBatch().
+	 *
+	 * @param values
+	 * @param count
+	 * @param results Bitmap with (count + 63) / 64 words, bit i tells whether values[i] got removed.
+	 */
+	void RemoveBatch(const ValueType* values, size_t count, uint64_t* results) {
+		memset(results, 0, (count + 63) / 64 * sizeof(uint64_t));
+		typename Reclaimer::Guard guard;
+		KeyType hashes[BATCH_GROUP_SIZE];
+		KeyType keys[BATCH_GROUP_SIZE];
+		for (size_t first = 0; first < count; first += BATCH_GROUP_SIZE) {
+			uint32_t group = (uint32_t)std::min((size_t)BATCH_GROUP_SIZE, count - first);
+			if (resize_cursor.load(std::memory_order_relaxed) <= hashtable.GetMask())
+				HelpResize();
+			PrefetchGroup(values + first, group, hashes, keys);
+			for (uint32_t i = 0; i < group; i++) {
+				size_t index = first + i;
+				results[index / 64] |= (uint64_t)RemoveHashed(values[index], hashes[i], keys[i]) << (index % 64);
+			}
+		}
+	}
+
+	/**
+	 * @brief Fill a table without elements with a lot of values at once, e.g. when warming it up
+	 * at startup. Instead of one CAS per value and repeated doubling, the directory gets its final
+	 * size up front and the whole list is built in one go by BuildList(). Duplicates are dropped.
+	 * No other thread may use the table during the build, afterwards it takes mixed traffic as usual.
+	 * If the table already holds elements, the values are just added in parallel.
+	 *
+	 * @param values
+	 * @param count
+	 * @param n_threads
+	 * @return size_t Number of distinct values that got added.
+	 */
+	size_t BulkBuild(const ValueType* values, size_t count, int n_threads) {
+		if (table_size.GetExact() != 0) {
+			size_t added = 0;
+#pragma omp parallel for num_threads(n_threads) reduction(+ : added)
+			for (size_t i = 0; i < count; i++)
+				added += Add(values[i]);
+			return added;
+		}
+		return BuildList(values, count, std::max(hashtable.GetMask(), GetMaskForSize(count)), n_threads);
+	}
+
+	/**
+	 * @brief Prepare the table for expected_size elements: the directory gets doubled up to the size
+	 * it would have with that many elements and all sentinel nodes get inserted by n_threads threads
+	 * in parallel, so neither doubling nor lazy bucket initialization happens on the hot path later.
+	 * The directory does not shrink below the reserved size. Safe to call while other threads use
+	 * the table.
+	 *
+	 * @param expected_size
+	 * @param n_threads Threads inserting sentinel nodes, 0 for the OpenMP default.
+	 */
+	void Reserve(size_t expected_size, int n_threads = 0) {
+		uint32_t mask = GetMaskForSize(expected_size);
+		uint32_t reserved = reserved_mask.load();
+		while (reserved < mask && !reserved_mask.compare_exchange_weak(reserved, mask)) {
+		}
+		for (uint32_t current_mask = hashtable.GetMask(); current_mask < mask; current_mask = hashtable.GetMask())
+			hashtable.Grow(current_mask);
+
+		if (n_threads <= 0)
+			n_threads = omp_get_max_threads();
+#pragma omp parallel num_threads(n_threads)
+		{
+			typename Reclaimer::Guard guard;
+			while (resize_cursor.load() < hashtable.GetNumberOfBuckets())
+				HelpResize();
+		}
+	}
+
+	/**
+	 * @brief Return the number of elements in the table. Exact as long as no Add() or Remove()
+	 * runs concurrently, otherwise it might miss some of them.
+	 *
+	 * @return size_t
+	 */
+	size_t Size() {
+		int64_t size = table_size.GetExact();
+		return size < 0 ? 0 : (size_t)size;
+	}
+
+	/**
+	 * @brief Visit the part of the list that belongs to one of number_of_ranges equal slices of the
+	 * split-order key space. Slice boundaries are sentinel keys of the buckets below number_of_ranges,
+	 * so we start from such a sentinel node, or from its closest initialized ancestor. Nothing gets
+	 * initialized, scans leave the directory alone.
+	 *
+	 * @param range
+	 * @param number_of_ranges Power of two.
+	 * @param function
+	 */
+	void ForEachInRange(uint32_t range, uint32_t number_of_ranges, const std::function<void(ValueType)>& function) {
+		const uint32_t KEY_BITS = sizeof(KeyType) * 8;
+		uint32_t range_bits = __builtin_ctz(number_of_ranges);
+		KeyType begin_key = range_bits == 0 ? 0 : (KeyType)range << (KEY_BITS - range_bits);
+		KeyType end_key = range_bits == 0 ? 0 : (KeyType)(range + 1) << (KEY_BITS - range_bits);  // 0 for the last range
+		uint32_t bucket = (uint32_t)ReverseBits(begin_key);
+		typename Reclaimer::Guard guard;
+		NodeType* start = hashtable.Load(bucket);
+		while (start == nullptr) {
+			bucket = GetParentBucket(bucket);
+			start = hashtable.Load(bucket);
+		}
+		list.ForEach(start, begin_key, end_key, function);
+	}
+
+	/**
+	 * @brief Call function for every element, from the calling thread. Weakly consistent, see
+	 * LockFreeList::ForEach(). function must not call into the table.
+	 *
+	 * @param function
+	 */
+	void ForEach(const std::function<void(ValueType)>& function) {
+		ForEachInRange(0, 1, function);
+	}
+
+	/**
+	 * @brief Call function for every element, from n_threads threads. The list gets split into
+	 * ranges at sentinel boundaries, RANGES_PER_THREAD per thread (at most one per bucket), which the
+	 * threads take dynamically, so a few crowded ranges do not hold up the others.
+	 * Weakly consistent like ForEach(). function has to be thread safe and must not call into the table.
+	 *
+	 * @param function
+	 * @param n_threads
+	 */
+	void ParallelForEach(const std::function<void(ValueType)>& function, int n_threads) {
+		uint32_t number_of_buckets = hashtable.GetNumberOfBuckets();
+		uint32_t number_of_ranges = 1;
+		while (number_of_ranges < (uint32_t)n_threads * RANGES_PER_THREAD && number_of_ranges < number_of_buckets)
+			number_of_ranges *= 2;
+#pragma omp parallel for num_threads(n_threads) schedule(dynamic)
+		for (uint32_t range = 0; range < number_of_ranges; range++)
+			ForEachInRange(range, number_of_ranges, function);
+	}
+
+	/**
+	 * @brief Write the elements with their split-order keys to a file, in list order, so loading it
+	 * needs neither hashing nor sorting. The list is walked with ForEach(), other threads may keep
+	 * using the table, the snapshot is then weakly consistent like ForEach().
+	 *
+	 * @param path
+	 * @return true
+	 * @return false if the file could not be written
+	 */
+	bool SaveSnapshot(const std::string& path) {
+		FILE* file = fopen(path.c_str(), "wb");
+		if (file == nullptr)
+			return false;
+		SnapshotHeader header = {SNAPSHOT_MAGIC, sizeof(KeyType), sizeof(KeyValue), (uint32_t)hash.GetKind(), hashtable.GetMask(), hash.GetSeed(), 0};
+		bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+		std::vector<KeyValue> buffer;
+		buffer.reserve(SNAPSHOT_BUFFER_SIZE);
+		auto Flush = [&]() {
+			written = written && fwrite(buffer.data(), sizeof(KeyValue), buffer.size(), file) == buffer.size();
+			header.count += buffer.size();
+			buffer.clear();
+		};
+		ForEach([&](ValueType value) {
+			buffer.push_back({MakeNormalKey(HashFunction(value)), value});
+			if (buffer.size() == SNAPSHOT_BUFFER_SIZE)
+				Flush();
+		});
+		Flush();
+		// the number of elements is only known now
+		written = written && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+		return fclose(file) == 0 && written;
+	}
+
+	/**
+	 * @brief Replace the list of a table without elements by the items of a snapshot. The sentinel
+	 * keys of a directory with mask + 1 buckets are the multiples of its lowest one, so they get
+	 * merged into the sorted items on the fly and stored in the directory as we go, one node after
+	 * the other with plain stores. No other thread may use the table meanwhile.
+	 *
+	 * @param items Data items sorted in list order.
+	 * @param count
+	 * @param mask Bucket mask of the saved table.
+	 * @return true
+	 * @return false if the mask is invalid or the items are not odd keys in strictly increasing order,
+	 * the table is then left with the items linked so far
+	 */
+	bool LinkSnapshot(const KeyValue* items, size_t count, uint32_t mask) {
+		if (mask == 0 || mask > MAX_BUCKET_MASK || (mask & (mask + 1)) != 0)
+			return false;
+		NodeType* tail = ClearList(mask);
+		const uint32_t sentinel_shift = sizeof(KeyType) * 8 - __builtin_popcount(mask);
+		NodeType* pred = list.GetHead();
+		auto Link = [&](KeyValue item) {
+			NodeType* node = Allocator::Allocate();
+			node->item = item;
+			pred->next.store(node, std::memory_order_relaxed);
+			pred = node;
+		};
+		uint32_t next_sentinel = 1;  // the head is the sentinel node of bucket 0
+		auto LinkSentinelsBelow = [&](KeyType key) {
+			for (; next_sentinel <= mask && ((KeyType)next_sentinel << sentinel_shift) < key; next_sentinel++) {
+				uint32_t bucket = (uint32_t)ReverseBits((KeyType)next_sentinel << sentinel_shift);
+				Link({MakeSentinelKey(bucket), bucket});
+				hashtable.Store(bucket, pred);
+			}
+		};
+
+		bool valid = true;
+		size_t i = 0;
+		for (; i < count; i++) {
+			KeyValue item = items[i];
+			if ((item.key & 1) == 0 || (i > 0 && !(items[i - 1] < item))) {
+				valid = false;
+				break;
+			}
+			LinkSentinelsBelow(item.key);
+			Link(item);
+		}
+		LinkSentinelsBelow(std::numeric_limits<KeyType>::max());
+		pred->next.store(tail);
+		table_size.Add((int64_t)i);
+		resize_cursor.store(mask + 1);
+		return valid;
+	}
+
+	HashKind GetHashKind() {
+		return hash.GetKind();
+	}
+
+	uint64_t GetSeed() {
+		return hash.GetSeed();
+	}
+
+	uint32_t GetNumberOfBuckets() {
+		return hashtable.GetNumberOfBuckets();
+	}
+
+	/**
+	 * @brief Change how the list handles failed CAS, before the table gets used.
+	 *
+	 * @param contention
+	 */
+	void SetContentionManagement(ContentionManagement contention) {
+		list.SetContentionManagement(contention);
+	}
+
+	/**
+	 * @brief Bytes taken by the linked nodes, sentinel nodes included, and the bucket directory.
+	 * Only meant for statistics while no other thread modifies the table.
+	 *
+	 * @return size_t
+	 */
+	size_t GetMemoryUsage() {
+		return list.GetNumberOfNodes() * sizeof(NodeType) + hashtable.GetMemoryUsage();
+	}
+
+	/**
+	 * @brief Return the string of the list for some debugging.
+	 *
+	 * @return std::string
+	 */
+	std::string ToString() {
+		return list.ToString();
+	}
+};
+
+#endif
@@ -0,0 +1,64 @@
+/**
+ * @file striped_counter.cpp
+ * @author Josef Salzmann &	Aleksandar Hadzhiyski
+ * @brief Counter with padded per-thread stripes that are periodically folded into a shared value.
+ * @date 2026-10-15
+ */
+#include "striped_counter.h"
+
+std::atomic<uint32_t> StripedCounter::next_stripe(0);
+
+StripedCounter::StripedCounter() {
+	for (uint32_t i = 0; i < NUMBER_OF_STRIPES; i++)
+		stripes[i].value.store(0, std::memory_order_relaxed);
+	approximate.store(0);
+}
+
+/**
+ * @brief Threads get their stripes round robin on first use, so up to NUMBER_OF_STRIPES
+ * threads never share one.
+ *
+ * @return uint32_t
+ */
+uint32_t StripedCounter::GetStripe() {
+	static thread_local uint32_t stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % NUMBER_OF_STRIPES;
+	return stripe;
+}
+
+/**
+ * @brief Add delta to the stripe of the calling thread and fold the stripe into the
+ * approximate value once it exceeds FOLD_THRESHOLD in either direction. Moving exactly the
+ * value we read keeps the sum of approximate value and stripes correct, even if another
+ * thread updates the same stripe in between.
+ *
+ * @param delta
+ */
+void StripedCounter::Add(int64_t delta) {
+	std::atomic<int64_t>& stripe = stripes[GetStripe()].value;
+	int64_t value = stripe.fetch_add(delta, std::memory_order_relaxed) + delta;
+	if (value >= FOLD_THRESHOLD || value <= -FOLD_THRESHOLD) {
+		stripe.fetch_sub(value, std::memory_order_relaxed);
+		approximate.fetch_add(value, std::memory_order_relaxed);
+	}
+}
+
+/**
+ * @brief Read the shared value, which lags behind by at most NUMBER_OF_STRIPES * FOLD_THRESHOLD.
+ *
+ * @return int64_t
+ */
+int64_t StripedCounter::GetApproximate() {
+	return approximate.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Sum up the shared value and all stripes.
+ *
+ * @return int64_t
+ */
+int64_t StripedCounter::GetExact() {
+	int64_t sum = approximate.load();
+	for (uint32_t i = 0; i < NUMBER_OF_STRIPES; i++)
+		sum += stripes[i].value.load();
+	return sum;
+}
@@ -0,0 +1,37 @@
+#ifndef STRIPED_COUNTER_H
+#define STRIPED_COUNTER_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+struct alignas(64) CounterStripe {
+	std::atomic<int64_t> value;
+};
+
+/**
+ * Counter that is cheap to update from many threads. Every thread updates its own cache line
+ * padded stripe and only folds it into the shared approximate value once it has drifted by
+ * FOLD_THRESHOLD, so the shared cache line is written once every FOLD_THRESHOLD updates.
+ * The approximate value is off by at most NUMBER_OF_STRIPES * FOLD_THRESHOLD, the exact value
+ * sums up all stripes and is exact as long as no update runs concurrently.
+ */
+class StripedCounter {
+   private:
+	static const uint32_t NUMBER_OF_STRIPES = 64;
+	static const int64_t FOLD_THRESHOLD = 32;
+	static std::atomic<uint32_t> next_stripe;
+	CounterStripe stripes[NUMBER_OF_STRIPES];
+	alignas(64) std::atomic<int64_t> approximate;
+	static uint32_t GetStripe();
+
+   public:
+	StripedCounter();
+	StripedCounter(const StripedCounter& striped_counter) = delete;
+	StripedCounter& operator=(const StripedCounter& a) = delete;
+	void Add(int64_t delta);
+	int64_t GetApproximate();
+	int64_t GetExact();
+};
+
+#endif
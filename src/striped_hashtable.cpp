@@ -0,0 +1,313 @@
+/**
+ * @file striped_hashtable.cpp
+ * @author Josef Salzmann &	Aleksandar Hadzhiyski
+ * @brief Lock striped hashtable with open addressing, as a stronger lock-based baseline.
+ * @date 2026-10-15
+ */
+#include "striped_hashtable.h"
+
+#include <immintrin.h>
+
+#include "epoch_reclamation.h"
+
+/**
+ * @brief Construct a table whose stripes start with INITIAL_CAPACITY empty slots each.
+ *
+ * @param reads Whether lookups lock their stripe or read optimistically.
+ * @param hash_kind Hash function used for the values.
+ * @param seed Seed of the hash function, random unless given.
+ */
+StripedHashTable::StripedHashTable(StripedReads reads, HashKind hash_kind, uint64_t seed) : reads(reads), hash_kind(hash_kind), seed(seed) {
+	for (StripedSegment& segment : segments) {
+		segment.sequence.store(0);
+		segment.slots.store(new StripedSlotArray(INITIAL_CAPACITY));
+		segment.size = 0;
+		segment.used = 0;
+	}
+}
+
+/**
+ * @brief Free the slot arrays. Replaced ones have been freed already or are owned by the epochs.
+ */
+StripedHashTable::~StripedHashTable() {
+	for (StripedSegment& segment : segments)
+		delete segment.slots.load();
+}
+
+KeyType StripedHashTable::HashFunction(ValueType value) {
+	return HashValue(hash_kind, seed, value);
+}
+
+/**
+ * @brief The stripe of a hash, taken from the top bits. The slot within the stripe is taken
+ * from the low bits, so the two do not correlate.
+ */
+StripedSegment* StripedHashTable::GetSegment(KeyType hash) {
+	return &segments[hash >> (sizeof(KeyType) * 8 - STRIPE_BITS)];
+}
+
+/**
+ * @brief Probe for a key, starting at its home slot until the first EMPTY slot.
+ * At most capacity slots are probed, so an optimistic reader that sees a torn state still stops.
+ *
+ * @param slot_array
+ * @param hash
+ * @param key
+ * @return StripedSlot* the FULL slot holding key or nullptr
+ */
+StripedSlot* StripedHashTable::Find(StripedSlotArray* slot_array, KeyType hash, ValueType key) {
+	uint32_t mask = slot_array->capacity - 1;
+	uint32_t index = (uint32_t)hash & mask;
+	for (uint32_t probes = 0; probes < slot_array->capacity; probes++) {
+		StripedSlot* slot = &slot_array->slots[index];
+		uint8_t state = slot->state.load(std::memory_order_relaxed);
+		if (state == EMPTY)
+			return nullptr;
+		if (state == FULL && slot->key.load(std::memory_order_relaxed) == key)
+			return slot;
+		index = (index + 1) & mask;
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Make the sequence odd before a writer holding the lock changes its stripe, so
+ * optimistic readers retry. Only needed with SEQLOCK reads.
+ */
+void StripedHashTable::BeginWrite(StripedSegment* segment) {
+	if (reads != StripedReads::SEQLOCK)
+		return;
+	segment->sequence.store(segment->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+void StripedHashTable::EndWrite(StripedSegment* segment) {
+	if (reads != StripedReads::SEQLOCK)
+		return;
+	segment->sequence.store(segment->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Put a key that is not in the stripe into the first free slot of its probe sequence.
+ * The stripe gets rehashed first if it would be more than three quarters used, to twice the
+ * capacity if more than half of the slots are FULL, otherwise just to drop the DELETED ones.
+ * The caller holds the lock of the stripe.
+ */
+void StripedHashTable::Insert(StripedSegment* segment, KeyType hash, ValueType key, ValueType value) {
+	StripedSlotArray* slot_array = segment->slots.load(std::memory_order_relaxed);
+	if ((segment->used + 1) * 4 > slot_array->capacity * 3) {
+		uint32_t capacity = slot_array->capacity;
+		if ((segment->size + 1) * 2 > capacity)
+			capacity *= 2;
+		Rehash(segment, capacity);
+		slot_array = segment->slots.load(std::memory_order_relaxed);
+	}
+
+	uint32_t mask = slot_array->capacity - 1;
+	uint32_t index = (uint32_t)hash & mask;
+	while (slot_array->slots[index].state.load(std::memory_order_relaxed) == FULL)
+		index = (index + 1) & mask;
+	StripedSlot* slot = &slot_array->slots[index];
+	BeginWrite(segment);
+	if (slot->state.load(std::memory_order_relaxed) == EMPTY)
+		segment->used++;
+	slot->key.store(key, std::memory_order_relaxed);
+	slot->value.store(value, std::memory_order_relaxed);
+	slot->state.store(FULL, std::memory_order_relaxed);
+	segment->size++;
+	EndWrite(segment);
+}
+
+/**
+ * @brief Move the FULL slots of a stripe into a fresh slot array. The new array is filled before
+ * it is published, so optimistic readers only have to retry for the switch itself. The old array
+ * is freed right away if every reader locks, otherwise once no reader can be inside it anymore.
+ * The caller holds the lock of the stripe.
+ */
+void StripedHashTable::Rehash(StripedSegment* segment, uint32_t capacity) {
+	StripedSlotArray* old_slot_array = segment->slots.load(std::memory_order_relaxed);
+	StripedSlotArray* slot_array = new StripedSlotArray(capacity);
+	uint32_t mask = capacity - 1;
+	for (uint32_t i = 0; i < old_slot_array->capacity; i++) {
+		StripedSlot* old_slot = &old_slot_array->slots[i];
+		if (old_slot->state.load(std::memory_order_relaxed) != FULL)
+			continue;
+		ValueType key = old_slot->key.load(std::memory_order_relaxed);
+		uint32_t index = (uint32_t)HashFunction(key) & mask;
+		while (slot_array->slots[index].state.load(std::memory_order_relaxed) != EMPTY)
+			index = (index + 1) & mask;
+		slot_array->slots[index].key.store(key, std::memory_order_relaxed);
+		slot_array->slots[index].value.store(old_slot->value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		slot_array->slots[index].state.store(FULL, std::memory_order_relaxed);
+	}
+
+	BeginWrite(segment);
+	segment->slots.store(slot_array, std::memory_order_release);
+	segment->used = segment->size;
+	EndWrite(segment);
+	if (reads == StripedReads::SEQLOCK)
+		EpochReclamation::Retire(old_slot_array, &DeleteSlotArray);
+	else
+		delete old_slot_array;
+}
+
+void StripedHashTable::DeleteSlotArray(void* slot_array) {
+	delete static_cast<StripedSlotArray*>(slot_array);
+}
+
+bool StripedHashTable::Add(ValueType value) {
+	KeyType hash = HashFunction(value);
+	StripedSegment* segment = GetSegment(hash);
+	segment->mutex.lock();
+	bool ret = Find(segment->slots.load(std::memory_order_relaxed), hash, value) == nullptr;
+	if (ret)
+		Insert(segment, hash, value, 0);
+	segment->mutex.unlock();
+	return ret;
+}
+
+bool StripedHashTable::Remove(ValueType value) {
+	KeyType hash = HashFunction(value);
+	StripedSegment* segment = GetSegment(hash);
+	segment->mutex.lock();
+	StripedSlot* slot = Find(segment->slots.load(std::memory_order_relaxed), hash, value);
+	if (slot != nullptr) {
+		BeginWrite(segment);
+		slot->state.store(DELETED, std::memory_order_relaxed);
+		segment->size--;
+		EndWrite(segment);
+	}
+	segment->mutex.unlock();
+	return slot != nullptr;
+}
+
+/**
+ * @brief Check if a value is contained in the table. With SEQLOCK reads we probe without the
+ * lock and accept the result only if the sequence of the stripe was even and unchanged all along,
+ * the epoch keeps the slot array alive in case a writer replaces it meanwhile.
+ *
+ * @param value
+ * @return true
+ * @return false
+ */
+bool StripedHashTable::Contains(ValueType value) {
+	KeyType hash = HashFunction(value);
+	StripedSegment* segment = GetSegment(hash);
+	if (reads == StripedReads::LOCKED) {
+		segment->mutex.lock();
+		bool ret = Find(segment->slots.load(std::memory_order_relaxed), hash, value) != nullptr;
+		segment->mutex.unlock();
+		return ret;
+	}
+
+	EpochGuard guard;
+	while (true) {
+		uint32_t sequence = segment->sequence.load(std::memory_order_acquire);
+		if (sequence & 1) {
+			_mm_pause();
+			continue;
+		}
+		bool ret = Find(segment->slots.load(std::memory_order_acquire), hash, value) != nullptr;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (segment->sequence.load(std::memory_order_relaxed) == sequence)
+			return ret;
+	}
+}
+
+size_t StripedHashTable::Size() {
+	size_t ret = 0;
+	for (StripedSegment& segment : segments) {
+		segment.mutex.lock();
+		ret += segment.size;
+		segment.mutex.unlock();
+	}
+	return ret;
+}
+
+/**
+ * @brief Rehash every stripe to the capacity it needs for its share of expected_size elements.
+ *
+ * @param expected_size
+ */
+void StripedHashTable::Reserve(size_t expected_size) {
+	size_t per_stripe = expected_size / NUMBER_OF_STRIPES + 1;
+	uint32_t capacity = INITIAL_CAPACITY;
+	while (per_stripe * 4 > (size_t)capacity * 3)
+		capacity *= 2;
+	for (StripedSegment& segment : segments) {
+		segment.mutex.lock();
+		if (segment.slots.load(std::memory_order_relaxed)->capacity < capacity)
+			Rehash(&segment, capacity);
+		segment.mutex.unlock();
+	}
+}
+
+/*
+ * Read-modify-write operations with the same semantics as the ones of LockBasedHashTable.
+ */
+
+bool StripedHashTable::PutIfAbsent(ValueType key, ValueType value, ValueType& existing) {
+	KeyType hash = HashFunction(key);
+	StripedSegment* segment = GetSegment(hash);
+	segment->mutex.lock();
+	StripedSlot* slot = Find(segment->slots.load(std::memory_order_relaxed), hash, key);
+	if (slot != nullptr)
+		existing = slot->value.load(std::memory_order_relaxed);
+	else
+		Insert(segment, hash, key, value);
+	segment->mutex.unlock();
+	return slot == nullptr;
+}
+
+bool StripedHashTable::Replace(ValueType key, ValueType expected, ValueType desired) {
+	KeyType hash = HashFunction(key);
+	StripedSegment* segment = GetSegment(hash);
+	segment->mutex.lock();
+	StripedSlot* slot = Find(segment->slots.load(std::memory_order_relaxed), hash, key);
+	bool ret = slot != nullptr && slot->value.load(std::memory_order_relaxed) == expected;
+	if (ret) {
+		BeginWrite(segment);
+		slot->value.store(desired, std::memory_order_relaxed);
+		EndWrite(segment);
+	}
+	segment->mutex.unlock();
+	return ret;
+}
+
+ValueType StripedHashTable::ComputeIfAbsent(ValueType key, const std::function<ValueType()>& factory) {
+	KeyType hash = HashFunction(key);
+	StripedSegment* segment = GetSegment(hash);
+	segment->mutex.lock();
+	StripedSlot* slot = Find(segment->slots.load(std::memory_order_relaxed), hash, key);
+	ValueType ret;
+	if (slot != nullptr) {
+		ret = slot->value.load(std::memory_order_relaxed);
+	} else {
+		ret = factory();
+		Insert(segment, hash, key, ret);
+	}
+	segment->mutex.unlock();
+	return ret;
+}
+
+ValueType StripedHashTable::FetchAdd(ValueType key, ValueType delta) {
+	KeyType hash = HashFunction(key);
+	StripedSegment* segment = GetSegment(hash);
+	segment->mutex.lock();
+	StripedSlot* slot = Find(segment->slots.load(std::memory_order_relaxed), hash, key);
+	ValueType ret = 0;
+	if (slot != nullptr) {
+		ret = slot->value.load(std::memory_order_relaxed);
+		BeginWrite(segment);
+		slot->value.store(ret + delta, std::memory_order_relaxed);
+		EndWrite(segment);
+	} else {
+		Insert(segment, hash, key, delta);
+	}
+	segment->mutex.unlock();
+	return ret;
+}
+
+std::string StripedHashTable::ToString() {
+	return "";  // we do not care
+}
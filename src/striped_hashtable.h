@@ -0,0 +1,103 @@
+#ifndef STRIPED_HASHTABLE_H
+#define STRIPED_HASHTABLE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include "hash_functions.h"
+#include "lock_free_hashtable.h"
+#include "lock_free_list.h"
+
+/**
+ * How StripedHashTable serves lookups. LOCKED takes the stripe lock like every other operation,
+ * SEQLOCK reads without locking and retries if a writer changed the stripe meanwhile.
+ */
+enum class StripedReads {
+	LOCKED,
+	SEQLOCK
+};
+
+/**
+ * Slot of the open addressing storage. The fields are atomic only so optimistic readers
+ * may read them while a writer changes them, writers hold the stripe lock.
+ */
+struct StripedSlot {
+	std::atomic<uint8_t> state;  // EMPTY, FULL or DELETED
+	std::atomic<ValueType> key;
+	std::atomic<ValueType> value;
+};
+
+struct StripedSlotArray {
+	const uint32_t capacity;  // power of two
+	StripedSlot* const slots;
+
+	explicit StripedSlotArray(uint32_t capacity) : capacity(capacity), slots(new StripedSlot[capacity]()) {}
+	~StripedSlotArray() {
+		delete[] slots;
+	}
+	StripedSlotArray(const StripedSlotArray& striped_slot_array) = delete;
+	StripedSlotArray& operator=(const StripedSlotArray& a) = delete;
+};
+
+/**
+ * One stripe: a lock and its own linear probing table, on cache lines of its own.
+ */
+struct alignas(64) StripedSegment {
+	std::mutex mutex;
+	std::atomic<uint32_t> sequence;  // odd while a writer changes the stripe, only used for SEQLOCK reads
+	std::atomic<StripedSlotArray*> slots;
+	uint32_t size;  // FULL slots
+	uint32_t used;  // FULL and DELETED slots, the rest is EMPTY
+};
+
+/**
+ * Lock-based baseline that is more realistic than one mutex around std::unordered_map.
+ * The top bits of the hash pick one of NUMBER_OF_STRIPES stripes, each with its own lock and its
+ * own open addressing table with linear probing, so operations on different stripes never contend
+ * and every stripe grows on its own. Removed elements leave DELETED slots behind, which get
+ * dropped whenever a stripe rehashes. With SEQLOCK reads, lookups do not lock at all, replaced
+ * slot arrays are then reclaimed with epochs.
+ */
+class StripedHashTable : public HashTable {
+   private:
+	static const uint32_t STRIPE_BITS = 6;
+	static const uint32_t NUMBER_OF_STRIPES = 1 << STRIPE_BITS;
+	static const uint32_t INITIAL_CAPACITY = 16;  // slots per stripe
+	static const uint8_t EMPTY = 0;
+	static const uint8_t FULL = 1;
+	static const uint8_t DELETED = 2;
+	const StripedReads reads;
+	const HashKind hash_kind;
+	const uint64_t seed;
+	StripedSegment segments[NUMBER_OF_STRIPES];
+	KeyType HashFunction(ValueType value);
+	StripedSegment* GetSegment(KeyType hash);
+	static StripedSlot* Find(StripedSlotArray* slot_array, KeyType hash, ValueType key);
+	void BeginWrite(StripedSegment* segment);
+	void EndWrite(StripedSegment* segment);
+	void Insert(StripedSegment* segment, KeyType hash, ValueType key, ValueType value);
+	void Rehash(StripedSegment* segment, uint32_t capacity);
+	static void DeleteSlotArray(void* slot_array);
+
+   public:
+	explicit StripedHashTable(StripedReads reads = StripedReads::LOCKED, HashKind hash_kind = HashKind::MIXER, uint64_t seed = RandomSeed());
+	StripedHashTable(const StripedHashTable& striped_hashtable) = delete;
+	StripedHashTable& operator=(const StripedHashTable& a) = delete;
+	~StripedHashTable() override;
+	bool Add(ValueType value) override;
+	bool Remove(ValueType value) override;
+	bool Contains(ValueType value) override;
+	size_t Size() override;
+	void Reserve(size_t expected_size) override;
+	bool PutIfAbsent(ValueType key, ValueType value, ValueType& existing);
+	bool Replace(ValueType key, ValueType expected, ValueType desired);
+	ValueType ComputeIfAbsent(ValueType key, const std::function<ValueType()>& factory);
+	ValueType FetchAdd(ValueType key, ValueType delta);
+	std::string ToString() override;
+};
+
+#endif
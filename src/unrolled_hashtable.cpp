@@ -0,0 +1,419 @@
+/**
+ * @file unrolled_hashtable.cpp
+ * @author Josef Salzmann &	Aleksandar Hadzhiyski
+ * @brief Split-ordered hashtable on an unrolled lock-free list with copy-on-write nodes.
+ * @date 2026-10-15
+ */
+#include "unrolled_hashtable.h"
+
+#include <sstream>
+
+#include "epoch_reclamation.h"
+#include "split_order.h"
+
+/**
+ * @brief Construct a new table with the sentinel node of bucket 0 as its only node.
+ *
+ * @param hash_kind Hash function used for the values.
+ * @param seed Seed of the hash function, random unless given.
+ */
+UnrolledHashTable::UnrolledHashTable(HashKind hash_kind, uint64_t seed) : hash_kind(hash_kind), seed(seed), hashtable(2) {
+	KeyValue sentinel = {0, 0};
+	head = NewNode(&sentinel, 1, nullptr);
+	hashtable.Store(0, head);
+}
+
+/**
+ * @brief Free all linked nodes. Only safe once no other thread accesses the table.
+ */
+UnrolledHashTable::~UnrolledHashTable() {
+	FreeNodes(head, nullptr);
+}
+
+KeyType UnrolledHashTable::HashFunction(ValueType value) {
+	return HashValue(hash_kind, seed, value);
+}
+
+KeyType UnrolledHashTable::MakeNormalKey(KeyType hash) {
+	return ReverseBits((hash & MASK) | HIGH);
+}
+
+KeyType UnrolledHashTable::MakeSentinelKey(uint32_t bucket) {
+	return ReverseBits(bucket & MASK);
+}
+
+UnrolledNode* UnrolledHashTable::GetSentinelNode(KeyType hash) {
+	return GetBucketSentinel((uint32_t)hash & hashtable.GetMask());
+}
+
+UnrolledNode* UnrolledHashTable::GetBucketSentinel(uint32_t bucket) {
+	UnrolledNode* sentinel = hashtable.Load(bucket);
+	if (sentinel == nullptr)
+		sentinel = InitializeBucket(bucket);
+	return sentinel;
+}
+
+/**
+ * @brief Lazily add the sentinel node of a bucket, starting from the sentinel node of its parent.
+ * The elements of the new bucket might share a data node with elements of the parent bucket,
+ * such a node gets split in two around the new sentinel node, which is published together
+ * with the two halves.
+ *
+ * @param bucket
+ * @return UnrolledNode* the sentinel node of bucket
+ */
+UnrolledNode* UnrolledHashTable::InitializeBucket(uint32_t bucket) {
+	UnrolledNode* start = GetBucketSentinel(GetParentBucket(bucket));
+	KeyValue item = {MakeSentinelKey(bucket), bucket};
+	UnrolledNode* sentinel;
+	while (true) {
+		UnrolledWindow w = Find(start, item);
+		if (w.curr != nullptr && IsSentinel(w.curr) && w.curr->keys[0] == item.key) {
+			sentinel = w.curr;  // someone else was faster
+			break;
+		}
+		if (w.curr == nullptr || IsSentinel(w.curr) || w.curr->keys[0] > item.key) {
+			sentinel = NewNode(&item, 1, w.curr);
+			UnrolledNode* expected = w.curr;
+			if (w.pred->next.compare_exchange_strong(expected, sentinel))
+				break;
+			delete sentinel;
+			continue;
+		}
+
+		UnrolledNode* node = w.curr;
+		if (!Freeze(node))
+			continue;
+		UnrolledNode* succ = GetPointer(node->next.load());
+		KeyValue items[UnrolledNode::CAPACITY];
+		uint32_t lower = 0;
+		for (uint32_t i = 0; i < node->count; i++) {
+			items[i] = {node->keys[i], node->values[i]};
+			if (node->keys[i] < item.key)
+				lower++;
+		}
+		UnrolledNode* upper_half = NewNode(items + lower, node->count - lower, succ);
+		sentinel = NewNode(&item, 1, upper_half);
+		UnrolledNode* lower_half = NewNode(items, lower, sentinel);
+		UnrolledNode* expected = node;
+		if (w.pred->next.compare_exchange_strong(expected, lower_half)) {
+			EpochReclamation::Retire(node, &DeleteNode);
+			break;
+		}
+		FreeNodes(lower_half, succ);
+	}
+	hashtable.Store(bucket, sentinel);
+	return sentinel;
+}
+
+/**
+ * @brief Walk from start to the first node that does not lie completely before item.
+ * Frozen nodes on the way get replaced with a copy, after which we start over, so the
+ * window never contains frozen nodes at the time we looked at them.
+ * Has to be called inside a critical section.
+ *
+ * @param start A sentinel node before item.
+ * @param item
+ * @return UnrolledWindow curr is the node item belongs into or before, pred the node before it
+ */
+UnrolledWindow UnrolledHashTable::Find(UnrolledNode* start, KeyValue item) {
+	while (true) {
+		UnrolledNode* prev = nullptr;
+		UnrolledNode* pred = start;
+		UnrolledNode* curr = GetPointer(pred->next.load());
+		bool restart = false;
+		while (curr != nullptr) {
+			UnrolledNode* succ = curr->next.load();
+			if (GetFlag(succ)) {
+				HelpReplace(pred, curr, GetPointer(succ));
+				restart = true;
+				break;
+			}
+			if (!Precedes(curr, item))
+				break;
+			prev = pred;
+			pred = curr;
+			curr = succ;
+		}
+		if (!restart)
+			return {prev, pred, curr};
+	}
+}
+
+/**
+ * @brief Replace a frozen node with an unfrozen copy of it. Whoever froze the node is about to
+ * replace it as well, only one of the two replacements makes it into the list.
+ *
+ * @param pred
+ * @param node The frozen node.
+ * @param succ Its successor.
+ */
+void UnrolledHashTable::HelpReplace(UnrolledNode* pred, UnrolledNode* node, UnrolledNode* succ) {
+	KeyValue items[UnrolledNode::CAPACITY];
+	for (uint32_t i = 0; i < node->count; i++)
+		items[i] = {node->keys[i], node->values[i]};
+	UnrolledNode* copy = NewNode(items, node->count, succ);
+	UnrolledNode* expected = node;
+	if (pred->next.compare_exchange_strong(expected, copy))
+		EpochReclamation::Retire(node, &DeleteNode);
+	else
+		delete copy;
+}
+
+UnrolledNode* UnrolledHashTable::GetPointer(UnrolledNode* node) {
+	return reinterpret_cast<UnrolledNode*>(reinterpret_cast<uintptr_t>(node) & ~(uintptr_t)1);
+}
+
+bool UnrolledHashTable::GetFlag(UnrolledNode* node) {
+	return reinterpret_cast<uintptr_t>(node) & 1;
+}
+
+/**
+ * @brief Mark the next pointer of a node, after which neither it nor the elements change.
+ *
+ * @param node
+ * @return true if we froze the node, false if it already was frozen
+ */
+bool UnrolledHashTable::Freeze(UnrolledNode* node) {
+	UnrolledNode* succ = node->next.load();
+	while (!GetFlag(succ)) {
+		UnrolledNode* marked = reinterpret_cast<UnrolledNode*>(reinterpret_cast<uintptr_t>(succ) | 1);
+		if (node->next.compare_exchange_weak(succ, marked))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Sentinel keys are even, normal keys are odd, and data nodes are never empty.
+ */
+bool UnrolledHashTable::IsSentinel(UnrolledNode* node) {
+	return (node->keys[0] & 1) == 0;
+}
+
+/**
+ * @brief Whether all elements of a node come before item in split order.
+ */
+bool UnrolledHashTable::Precedes(UnrolledNode* node, KeyValue item) {
+	if (IsSentinel(node))
+		return node->keys[0] < item.key;
+	uint32_t last = node->count - 1;
+	return KeyValue{node->keys[last], node->values[last]} < item;
+}
+
+/**
+ * @brief Compare item against all slots of a node at once. There is no early exit, so the
+ * compiler can turn the loop into a few vector compares.
+ */
+bool UnrolledHashTable::ContainsItem(UnrolledNode* node, KeyValue item) {
+	bool found = false;
+	for (uint32_t i = 0; i < UnrolledNode::CAPACITY; i++)
+		found |= (i < node->count) & (node->keys[i] == item.key) & (node->values[i] == item.value);
+	return found;
+}
+
+/**
+ * @brief Allocate a node holding count sorted elements. Unused slots are zeroed.
+ */
+UnrolledNode* UnrolledHashTable::NewNode(const KeyValue* items, uint32_t count, UnrolledNode* next) {
+	UnrolledNode* node = new UnrolledNode();
+	node->count = count;
+	for (uint32_t i = 0; i < count; i++) {
+		node->keys[i] = items[i].key;
+		node->values[i] = items[i].value;
+	}
+	node->next.store(next, std::memory_order_relaxed);
+	return node;
+}
+
+/**
+ * @brief Delete the chain of nodes from first up to, but not including, last.
+ */
+void UnrolledHashTable::FreeNodes(UnrolledNode* first, UnrolledNode* last) {
+	while (first != last) {
+		UnrolledNode* next = GetPointer(first->next.load(std::memory_order_relaxed));
+		delete first;
+		first = next;
+	}
+}
+
+void UnrolledHashTable::DeleteNode(void* node) {
+	delete static_cast<UnrolledNode*>(node);
+}
+
+/**
+ * @brief Add an element to the hashtable. The element goes into the first data node that does not
+ * lie before it, or at the end of the data node before that, or into a new node of its own if
+ * it sits between two sentinel nodes. A full node gets split into two halves.
+ *
+ * @param value Value to be added to the hashtable.
+ * @return true
+ * @return false
+ */
+bool UnrolledHashTable::Add(ValueType value) {
+	EpochGuard guard;
+	KeyType hash = HashFunction(value);
+	UnrolledNode* start = GetSentinelNode(hash);
+	KeyValue item = {MakeNormalKey(hash), value};
+	while (true) {
+		UnrolledWindow w = Find(start, item);
+		UnrolledNode* node;
+		UnrolledNode* pred;
+		if (w.curr != nullptr && !IsSentinel(w.curr)) {
+			node = w.curr;
+			pred = w.pred;
+		} else if (!IsSentinel(w.pred)) {
+			node = w.pred;
+			pred = w.prev;
+		} else {
+			UnrolledNode* new_node = NewNode(&item, 1, w.curr);
+			UnrolledNode* expected = w.curr;
+			if (w.pred->next.compare_exchange_strong(expected, new_node))
+				break;
+			delete new_node;
+			continue;
+		}
+
+		if (ContainsItem(node, item))
+			return false;
+		if (!Freeze(node))
+			continue;
+		UnrolledNode* succ = GetPointer(node->next.load());
+		if (node == w.pred && succ != w.curr) {
+			// a sentinel node got linked behind node since Find(), item might belong behind it
+			HelpReplace(pred, node, succ);
+			continue;
+		}
+		KeyValue items[UnrolledNode::CAPACITY + 1];
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < node->count; i++) {
+			KeyValue current = {node->keys[i], node->values[i]};
+			if (count == i && item < current)
+				items[count++] = item;
+			items[count++] = current;
+		}
+		if (count == node->count)
+			items[count++] = item;
+
+		UnrolledNode* replacement;
+		if (count <= UnrolledNode::CAPACITY) {
+			replacement = NewNode(items, count, succ);
+		} else {
+			uint32_t half = count / 2;
+			UnrolledNode* upper_half = NewNode(items + half, count - half, succ);
+			replacement = NewNode(items, half, upper_half);
+		}
+		UnrolledNode* expected = node;
+		if (pred->next.compare_exchange_strong(expected, replacement)) {
+			EpochReclamation::Retire(node, &DeleteNode);
+			break;
+		}
+		FreeNodes(replacement, succ);
+	}
+
+	table_size.Add(1);
+	uint32_t mask = hashtable.GetMask();
+	if (table_size.GetApproximate() > (int64_t)MAX_AVERAGE_BUCKET_SIZE * (mask + 1) && mask < MAX_BUCKET_MASK)
+		hashtable.Grow(mask);  // if the CAS fails someone else already doubled the table
+	return true;
+}
+
+/**
+ * @brief Check if a value is contained in the hashtable. Readers neither help nor retry,
+ * the elements of a node never change, even after it got frozen or replaced.
+ *
+ * @param value Value for which we check.
+ * @return true
+ * @return false
+ */
+bool UnrolledHashTable::Contains(ValueType value) {
+	EpochGuard guard;
+	KeyType hash = HashFunction(value);
+	UnrolledNode* node = GetPointer(GetSentinelNode(hash)->next.load());
+	KeyValue item = {MakeNormalKey(hash), value};
+	while (node != nullptr && Precedes(node, item))
+		node = GetPointer(node->next.load());
+	return node != nullptr && !IsSentinel(node) && ContainsItem(node, item);
+}
+
+/**
+ * @brief Remove an element from the hashtable. A node that runs empty is unlinked, a node that
+ * together with its successor holds at most MERGE_THRESHOLD elements absorbs the successor,
+ * which has to be frozen as well for that.
+ *
+ * @param value The value to be removed.
+ * @return true
+ * @return false
+ */
+bool UnrolledHashTable::Remove(ValueType value) {
+	EpochGuard guard;
+	KeyType hash = HashFunction(value);
+	UnrolledNode* start = GetSentinelNode(hash);
+	KeyValue item = {MakeNormalKey(hash), value};
+	while (true) {
+		UnrolledWindow w = Find(start, item);
+		UnrolledNode* node = w.curr;
+		if (node == nullptr || IsSentinel(node) || !ContainsItem(node, item))
+			return false;
+		if (!Freeze(node))
+			continue;
+		UnrolledNode* succ = GetPointer(node->next.load());
+		KeyValue items[UnrolledNode::CAPACITY];
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < node->count; i++) {
+			if (node->keys[i] != item.key || node->values[i] != item.value)
+				items[count++] = {node->keys[i], node->values[i]};
+		}
+
+		UnrolledNode* replacement = succ;
+		UnrolledNode* merged = nullptr;
+		if (count > 0) {
+			if (succ != nullptr && !IsSentinel(succ) && count + succ->count <= MERGE_THRESHOLD && Freeze(succ)) {
+				merged = succ;
+				for (uint32_t i = 0; i < succ->count; i++)
+					items[count++] = {succ->keys[i], succ->values[i]};
+			}
+			UnrolledNode* next = merged != nullptr ? GetPointer(merged->next.load()) : succ;
+			replacement = NewNode(items, count, next);
+		}
+		UnrolledNode* expected = node;
+		if (w.pred->next.compare_exchange_strong(expected, replacement)) {
+			EpochReclamation::Retire(node, &DeleteNode);
+			if (merged != nullptr)
+				EpochReclamation::Retire(merged, &DeleteNode);
+			break;
+		}
+		if (count > 0)
+			delete replacement;  // a frozen successor we wanted to merge gets copied by the next one passing by
+	}
+	table_size.Add(-1);
+	return true;
+}
+
+/**
+ * @brief Return the number of elements in the table. Exact as long as no Add() or Remove()
+ * runs concurrently.
+ *
+ * @return size_t
+ */
+size_t UnrolledHashTable::Size() {
+	int64_t size = table_size.GetExact();
+	return size < 0 ? 0 : (size_t)size;
+}
+
+std::string UnrolledHashTable::ToString() {
+	std::stringstream ss;
+	int count = 0;
+	UnrolledNode* node = head;
+	while (node != nullptr) {
+		ss << "Node " << count << ": ";
+		if (IsSentinel(node))
+			ss << "Sentinel-Node ";
+		for (uint32_t i = 0; i < node->count; i++)
+			ss << "(Key " << node->keys[i] << ", Value " << node->values[i] << ") ";
+		ss << "\n";
+		count++;
+		node = GetPointer(node->next.load());
+	}
+	return ss.str();
+}
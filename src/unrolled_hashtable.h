@@ -0,0 +1,92 @@
+#ifndef UNROLLED_HASHTABLE_H
+#define UNROLLED_HASHTABLE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include "bucket_directory.h"
+#include "hash_functions.h"
+#include "lock_free_hashtable.h"
+#include "striped_counter.h"
+
+/**
+ * Node of the unrolled split-ordered list, exactly one cache line. Data nodes hold up to
+ * CAPACITY elements sorted by split-order key and value, sentinel nodes hold their (even) key
+ * in keys[0]. The elements of a published node never change, updates replace the whole node.
+ */
+struct alignas(64) UnrolledNode {
+	static const uint32_t CAPACITY = (64 - 16) / (sizeof(KeyType) + sizeof(ValueType));
+	std::atomic<UnrolledNode*> next;  // marked in the lowest bit once the node is frozen
+	uint32_t count;  // number of elements, 1 for sentinel nodes
+	KeyType keys[CAPACITY];
+	ValueType values[CAPACITY];
+};
+
+static_assert(sizeof(UnrolledNode) == 64, "unrolled nodes should fill exactly one cache line");
+
+struct UnrolledWindow {
+	UnrolledNode* prev;  // node before pred, nullptr if pred is the start node
+	UnrolledNode* pred;
+	UnrolledNode* curr;
+};
+
+/**
+ * Split-ordered hashtable on an unrolled list. Every data node packs several elements into one
+ * cache line, so scanning a bucket costs one or two line fetches instead of one miss per element.
+ * Nodes are copy-on-write: a writer freezes a node by marking its next pointer, builds the
+ * replacement (with the element added or removed, split in two if full, merged with its successor
+ * if both are almost empty) and swings the pointer of the predecessor. Threads running into a
+ * frozen node replace it with a plain copy, so a stalled writer cannot block anybody.
+ * Sentinel nodes are never frozen, so the directory can point to them. Replaced nodes are
+ * reclaimed with epochs, independent of the reclamation of the split-ordered list.
+ */
+class UnrolledHashTable : public HashTable {
+   private:
+	const HashKind hash_kind;
+	const uint64_t seed;
+	UnrolledNode* head;
+	BucketDirectory<UnrolledNode> hashtable;
+	StripedCounter table_size;  // number of elements in the table
+	const uint32_t MAX_AVERAGE_BUCKET_SIZE = 4;  // if table_size > MAX_AVERAGE_BUCKET_SIZE * size(hashtable) then we double the number of hashtable entries
+	const uint32_t MERGE_THRESHOLD = UnrolledNode::CAPACITY * 2 / 3;  // neighbours are merged if they hold at most that many elements together
+	const KeyType HIGH = (KeyType)1 << (sizeof(KeyType) * 8 - 1);
+#ifdef SPLIT_ORDER_KEYS_64
+	const KeyType MASK = 0x7FFFFFFFFFFFFFFF;
+	const uint32_t MAX_BUCKET_MASK = 0x7FFFFFFF;
+#else
+	const KeyType MASK = 0x00FFFFFF;
+	const uint32_t MAX_BUCKET_MASK = 0x00FFFFFF;
+#endif
+	KeyType HashFunction(ValueType value);
+	KeyType MakeNormalKey(KeyType hash);
+	KeyType MakeSentinelKey(uint32_t bucket);
+	UnrolledNode* GetSentinelNode(KeyType hash);
+	UnrolledNode* GetBucketSentinel(uint32_t bucket);
+	UnrolledNode* InitializeBucket(uint32_t bucket);
+	UnrolledWindow Find(UnrolledNode* start, KeyValue item);
+	void HelpReplace(UnrolledNode* pred, UnrolledNode* node, UnrolledNode* succ);
+	static UnrolledNode* GetPointer(UnrolledNode* node);
+	static bool GetFlag(UnrolledNode* node);
+	static bool Freeze(UnrolledNode* node);
+	static bool IsSentinel(UnrolledNode* node);
+	static bool Precedes(UnrolledNode* node, KeyValue item);
+	static bool ContainsItem(UnrolledNode* node, KeyValue item);
+	static UnrolledNode* NewNode(const KeyValue* items, uint32_t count, UnrolledNode* next);
+	static void FreeNodes(UnrolledNode* first, UnrolledNode* last);
+	static void DeleteNode(void* node);
+
+   public:
+	explicit UnrolledHashTable(HashKind hash_kind = HashKind::MIXER, uint64_t seed = RandomSeed());
+	UnrolledHashTable(const UnrolledHashTable& unrolled_hashtable) = delete;
+	UnrolledHashTable& operator=(const UnrolledHashTable& a) = delete;
+	~UnrolledHashTable() override;
+	bool Add(ValueType value) override;
+	bool Remove(ValueType value) override;
+	bool Contains(ValueType value) override;
+	size_t Size() override;
+	std::string ToString() override;
+};
+
+#endif